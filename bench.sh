@@ -0,0 +1,153 @@
+#!/bin/sh
+# Decode throughput benchmark for the *_dump tools.
+#
+#   Usage: bench.sh <tool-dir> [runs]
+#
+# Generates a small corpus next to the build tree (reusing it on later
+# runs), decodes each corpus with the matching tool `runs` times after one
+# warmup pass, and reports MB/s and peak RSS.  Results are written to
+# bench_results.txt; the first run also stores bench_baseline.txt and later
+# runs print the delta against it, so a puff.c or zstd_decompress.c change
+# can be judged with `make bench` before and after.
+#
+# Corpus generation needs gzip for the gzip corpus, python3 (zlib module)
+# for the deflate/zlib corpora and the zstd CLI for the zstd corpus; any
+# corpus whose generator is missing is skipped with a note.
+
+TOOL_DIR=${1:?usage: bench.sh <tool-dir> [runs]}
+RUNS=${2:-5}
+CORPUS=bench_corpus
+RESULTS=bench_results.txt
+BASELINE=bench_baseline.txt
+
+TIME_CMD=""
+if command -v /usr/bin/time >/dev/null 2>&1 &&
+   /usr/bin/time -f %M true >/dev/null 2>&1; then
+    TIME_CMD="/usr/bin/time -f %M -o $CORPUS/rss.tmp"
+fi
+
+now_ms() {
+    # date +%N is a GNU extension; fall back to whole seconds elsewhere
+    ns=$(date +%s%N 2>/dev/null)
+    case $ns in
+        *N) echo $(( $(date +%s) * 1000 )) ;;
+        *)  echo $(( ns / 1000000 )) ;;
+    esac
+}
+
+mkdir -p $CORPUS
+
+# --- corpus generation (only when missing, so numbers stay comparable) ---
+
+if [ ! -f $CORPUS/huge.gz ] && command -v gzip >/dev/null 2>&1; then
+    # one huge file and a swarm of small files, from repeating text so the
+    # decode is dominated by match copies like real captures are
+    awk 'BEGIN { for (i = 0; i < 400000; i++)
+                     print "the quick brown fox jumps over the lazy dog", i }' \
+        > $CORPUS/huge.txt
+    # compress through stdin so no FNAME field lands in the gzip header
+    gzip -c -6 < $CORPUS/huge.txt > $CORPUS/huge.gz
+    i=0
+    while [ $i -lt 64 ]; do
+        head -c 4096 $CORPUS/huge.txt | tail -c 2048 | gzip -c -6 \
+            > $CORPUS/small_$i.gz
+        i=$((i + 1))
+    done
+    ls $CORPUS/small_*.gz > $CORPUS/gzip_swarm.list
+fi
+
+if [ ! -f $CORPUS/huge.deflate ] && command -v python3 >/dev/null 2>&1 &&
+   [ -f $CORPUS/huge.txt ]; then
+    python3 - $CORPUS <<'EOF'
+import sys, zlib
+corpus = sys.argv[1]
+data = open(corpus + "/huge.txt", "rb").read()
+c = zlib.compressobj(6, zlib.DEFLATED, -15)
+open(corpus + "/huge.deflate", "wb").write(c.compress(data) + c.flush())
+open(corpus + "/huge.zlib", "wb").write(zlib.compress(data, 6))
+# level 1 on short pieces leans on fixed-Huffman blocks
+c = zlib.compressobj(1, zlib.DEFLATED, -15)
+out = bytearray()
+for i in range(0, 1 << 20, 1024):
+    out += c.compress(data[i:i + 1024])
+out += c.flush()
+open(corpus + "/fixed.deflate", "wb").write(bytes(out))
+EOF
+fi
+
+if [ ! -f $CORPUS/frames.zst ] && command -v zstd >/dev/null 2>&1 &&
+   [ -f $CORPUS/huge.txt ]; then
+    zstd -q -f -3 $CORPUS/huge.txt -o $CORPUS/huge.zst
+    # many-frame input: independent frames back to back
+    rm -f $CORPUS/frames.zst
+    i=0
+    while [ $i -lt 16 ]; do
+        head -c $(( (i + 1) * 65536 )) $CORPUS/huge.txt | tail -c 65536 | \
+            zstd -q -3 >> $CORPUS/frames.zst
+        i=$((i + 1))
+    done
+fi
+
+# --- measurement ---
+
+: > $RESULTS
+
+bench_one() {
+    label=$1; tool=$2; shift 2
+    # the input (a file, or the list file after -B) is the last argument
+    for input in "$@"; do :; done
+    if [ ! -f "$input" ]; then
+        echo "$label skipped (no corpus)" | tee -a $RESULTS
+        return
+    fi
+    if [ "$1" = "-B" ]; then
+        bytes=$(cat $(cat "$input") | wc -c)
+    else
+        bytes=$(wc -c < "$input")
+    fi
+    "$TOOL_DIR/$tool" "$@" >/dev/null 2>&1        # warmup
+    start=$(now_ms)
+    i=0
+    while [ $i -lt $RUNS ]; do
+        "$TOOL_DIR/$tool" "$@" >/dev/null 2>&1
+        i=$((i + 1))
+    done
+    elapsed=$(( $(now_ms) - start ))
+    [ $elapsed -lt 1 ] && elapsed=1
+    mbs=$(( bytes * RUNS * 1000 / elapsed / 1048576 ))
+    rss=-
+    if [ -n "$TIME_CMD" ]; then
+        $TIME_CMD "$TOOL_DIR/$tool" "$@" >/dev/null 2>&1
+        rss=$(cat $CORPUS/rss.tmp)
+    fi
+    echo "$label ${mbs} MB/s peak_rss_kb=$rss" | tee -a $RESULTS
+}
+
+bench_one gzip_huge      gzip_dump $CORPUS/huge.gz
+bench_one gzip_swarm     gzip_dump -B $CORPUS/gzip_swarm.list
+bench_one deflate_huge   deflate_dump $CORPUS/huge.deflate
+bench_one deflate_fixed  deflate_dump $CORPUS/fixed.deflate
+bench_one zlib_huge      zlib_dump $CORPUS/huge.zlib
+bench_one zstd_huge      zstd_dump $CORPUS/huge.zst
+bench_one zstd_frames    zstd_dump $CORPUS/frames.zst
+rm -f $CORPUS/rss.tmp
+
+# --- baseline comparison ---
+
+if [ ! -f $BASELINE ]; then
+    cp $RESULTS $BASELINE
+    echo "stored new baseline in $BASELINE"
+else
+    echo "--- vs $BASELINE ---"
+    while read -r label mbs _; do
+        base=$(awk -v l="$label" '$1 == l { print $2 }' $BASELINE)
+        case $base in
+            ''|*[!0-9]*) continue ;;
+        esac
+        case $mbs in
+            ''|*[!0-9]*) continue ;;
+        esac
+        [ "$base" -lt 1 ] && base=1
+        echo "$label ${mbs} MB/s (baseline ${base}, $(( mbs * 100 / base ))%)"
+    done < $RESULTS
+fi
@@ -0,0 +1,50 @@
+/*
+ * cfb2json.c
+ * Copyright (C) 2024 sunh20
+ * Convert --format=binary dump output back to JSON text.
+ *
+ * Usage: cfb2json file.cfb [file.cfb ...]
+ *
+ * The dump tools write a compact length-prefixed binary encoding when
+ * --format=binary is given (see utils.c for the layout); this reads such
+ * a file back into a tree and prints it as the usual formatted JSON on
+ * stdout for human inspection.
+ */
+
+#include <stdio.h>
+#include "utils.h"
+
+static int convert_file(const char *name)
+{
+    FILE *file = fopen(name, "rb");
+    cJSON *json;
+
+    if (file == NULL) {
+        fprintf(stderr, "could not open %s\n", name);
+        return 3;
+    }
+    json = read_binary_from_file(file);
+    fclose(file);
+    if (json == NULL) {
+        fprintf(stderr, "%s is not a valid binary dump\n", name);
+        return 3;
+    }
+    write_json_to_file(json, stdout);
+    cJSON_Delete(json);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    int ret = 0;
+    char *arg;
+
+    if (argc < 2) {
+        fprintf(stderr, "usage: cfb2json file.cfb [file.cfb ...]\n");
+        return 3;
+    }
+    while (arg = *++argv, --argc)
+        if (convert_file(arg))
+            ret = 3;
+    return ret;
+}
@@ -0,0 +1,365 @@
+/* In-process dump API -- see cfe.h.  The heavy lifting is done by the
+   same decoders the command line tools use (puff.c, zstd_decompress.c);
+   this file wraps them behind buffer-in/events-out entry points so a
+   host process can ingest structure without exec, temp files or JSON
+   text parsing. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <setjmp.h>
+#include "cfe.h"
+#include "puff.h"
+#include "zstd_decompress.h"
+
+static unsigned int cfe_le32(const unsigned char *buf)
+{
+    return (unsigned int)buf[0] | ((unsigned int)buf[1] << 8) |
+           ((unsigned int)buf[2] << 16) | ((unsigned int)buf[3] << 24);
+}
+
+/* Walk a decoded cJSON tree and replay it as writer events, depth first
+   in document order, so callers see exactly what the JSON files carry */
+static void cfe_emit(const cfe_writer_t *writer, void *user,
+                     const char *name, const cJSON *item)
+{
+    const cJSON *child;
+
+    if (cJSON_IsObject(item)) {
+        if (writer->begin_object)
+            writer->begin_object(user, name);
+        for (child = item->child; child != NULL; child = child->next)
+            cfe_emit(writer, user, child->string, child);
+        if (writer->end_object)
+            writer->end_object(user);
+    } else if (cJSON_IsArray(item)) {
+        if (writer->begin_array)
+            writer->begin_array(user, name);
+        for (child = item->child; child != NULL; child = child->next)
+            cfe_emit(writer, user, NULL, child);
+        if (writer->end_array)
+            writer->end_array(user);
+    } else if (cJSON_IsNumber(item)) {
+        if (writer->on_number)
+            writer->on_number(user, name, item->valuedouble);
+    } else if (cJSON_IsString(item)) {
+        if (writer->on_string)
+            writer->on_string(user, name, item->valuestring);
+    }
+}
+
+static void cfe_emit_tree(const cfe_writer_t *writer, void *user, cJSON *json)
+{
+    if (writer != NULL)
+        cfe_emit(writer, user, NULL, json);
+    cJSON_Delete(json);
+}
+
+int cfe_identify(const unsigned char *buf, size_t len)
+{
+    unsigned int magic;
+
+    if (buf == NULL || len < 2)
+        return CFE_FORMAT_UNKNOWN;
+    if (len >= 3 && buf[0] == 0x1f && buf[1] == 0x8b && buf[2] == 8)
+        return CFE_FORMAT_GZIP;
+    if (len >= 4) {
+        magic = cfe_le32(buf);
+        if (magic == 0xFD2FB528U || (magic & 0xFFFFFFF0U) == 0x184D2A50U)
+            return CFE_FORMAT_ZSTD;
+        if (magic == 0x184D2204U)
+            return CFE_FORMAT_LZ4;
+    }
+    if (buf[0] == 0x78 && ((unsigned int)buf[0] * 256 + buf[1]) % 31 == 0)
+        return CFE_FORMAT_ZLIB;
+    return CFE_FORMAT_UNKNOWN;
+}
+
+int cfe_dump_deflate(const unsigned char *buf, size_t len,
+                     const cfe_writer_t *writer, void *user)
+{
+    unsigned long sourcelen = (unsigned long)len, destlen = 0;
+    cJSON *json = cJSON_CreateObject();
+    int ret;
+
+    if (json == NULL)
+        return -1;
+    ret = puff(NIL, &destlen, buf, &sourcelen, json);
+    cfe_emit_tree(writer, user, json);
+    return ret;
+}
+
+int cfe_dump_zlib(const unsigned char *buf, size_t len,
+                  const cfe_writer_t *writer, void *user)
+{
+    size_t at = 0;
+    int ret = 0;
+    cJSON *json, *streams_json, *stream_json, *header_json;
+
+    if (cfe_identify(buf, len) != CFE_FORMAT_ZLIB || len < 6)
+        return -1;
+    json = cJSON_CreateObject();
+    if (json == NULL)
+        return -1;
+    streams_json = cJSON_AddArrayToObject(json, "ZLIB_STREAMS");
+
+    while (at + 6 <= len && cfe_identify(buf + at, len - at) == CFE_FORMAT_ZLIB) {
+        unsigned long sourcelen, destlen = 0;
+        int err;
+
+        stream_json = cJSON_CreateObject();
+        cJSON_AddItemToArray(streams_json, stream_json);
+
+        header_json = cJSON_AddObjectToObject(stream_json, "ZLIB_HEADER");
+        cJSON_AddNumberToObject(header_json, "CMF", buf[at]);
+        cJSON_AddNumberToObject(header_json, "FLG", buf[at + 1]);
+
+        sourcelen = (unsigned long)(len - at - 2);
+        err = puff(NIL, &destlen, buf + at + 2, &sourcelen, stream_json);
+        if (err) {
+            ret = err;
+            break;
+        }
+        at += 2 + sourcelen;
+        if (at + 4 <= len) {
+            /* the Adler-32 trailer is stored big endian */
+            cJSON_AddNumberToObject(stream_json, "ADLER32",
+                                    ((unsigned int)buf[at] << 24) |
+                                    ((unsigned int)buf[at + 1] << 16) |
+                                    ((unsigned int)buf[at + 2] << 8) |
+                                    (unsigned int)buf[at + 3]);
+        }
+        at += 4;
+    }
+    cfe_emit_tree(writer, user, json);
+    return ret;
+}
+
+/* Size of the variable-length gzip member header at buf, or 0 when it is
+   malformed or runs past the end of the buffer */
+static size_t cfe_gzip_header_size(const unsigned char *buf, size_t len)
+{
+    unsigned char flags;
+    size_t at = 10;
+
+    if (len < 10 || buf[0] != 0x1f || buf[1] != 0x8b || buf[2] != 8)
+        return 0;
+    flags = buf[3];
+    if (flags & 4) {                    /* FEXTRA */
+        if (at + 2 > len)
+            return 0;
+        at += 2 + ((size_t)buf[at] | ((size_t)buf[at + 1] << 8));
+    }
+    if (flags & 8) {                    /* FNAME */
+        while (at < len && buf[at])
+            at++;
+        at++;
+    }
+    if (flags & 16) {                   /* FCOMMENT */
+        while (at < len && buf[at])
+            at++;
+        at++;
+    }
+    if (flags & 2)                      /* FHCRC */
+        at += 2;
+    return at > len ? 0 : at;
+}
+
+int cfe_dump_gzip(const unsigned char *buf, size_t len,
+                  const cfe_writer_t *writer, void *user)
+{
+    size_t at = 0, header_size;
+    int ret = 0;
+    cJSON *json, *members_json, *member_json, *header_json;
+
+    if (cfe_identify(buf, len) != CFE_FORMAT_GZIP)
+        return -1;
+    json = cJSON_CreateObject();
+    if (json == NULL)
+        return -1;
+    members_json = cJSON_AddArrayToObject(json, "GZIP_MEMBERS");
+
+    while (at + 18 <= len && buf[at] == 0x1f && buf[at + 1] == 0x8b) {
+        unsigned long sourcelen, destlen = 0;
+        int err;
+
+        member_json = cJSON_CreateObject();
+        cJSON_AddItemToArray(members_json, member_json);
+
+        header_size = cfe_gzip_header_size(buf + at, len - at);
+        if (header_size == 0) {
+            ret = -1;
+            break;
+        }
+        header_json = cJSON_AddObjectToObject(member_json, "GZIP_HEADER");
+        cJSON_AddNumberToObject(header_json, "COMPRESSION_METHOD", buf[at + 2]);
+        cJSON_AddNumberToObject(header_json, "FLG", buf[at + 3]);
+        cJSON_AddNumberToObject(header_json, "MTIME", cfe_le32(buf + at + 4));
+        cJSON_AddNumberToObject(header_json, "XFL", buf[at + 8]);
+        cJSON_AddNumberToObject(header_json, "OS", buf[at + 9]);
+
+        sourcelen = (unsigned long)(len - at - header_size);
+        err = puff(NIL, &destlen, buf + at + header_size, &sourcelen,
+                   member_json);
+        if (err) {
+            ret = err;
+            break;
+        }
+        at += header_size + sourcelen;
+        if (at + 8 <= len) {
+            cJSON_AddNumberToObject(member_json, "CRC32", cfe_le32(buf + at));
+            cJSON_AddNumberToObject(member_json, "ISIZE", cfe_le32(buf + at + 4));
+        }
+        at += 8;
+    }
+    cfe_emit_tree(writer, user, json);
+    return ret;
+}
+
+int cfe_dump_zstd(const unsigned char *buf, size_t len,
+                  const cfe_writer_t *writer, void *user)
+{
+    size_t at = 0;
+    int ret = 0;
+    cJSON *json, *frames_json, *frame_json;
+
+    if (cfe_identify(buf, len) != CFE_FORMAT_ZSTD)
+        return -1;
+    json = cJSON_CreateObject();
+    if (json == NULL)
+        return -1;
+    frames_json = cJSON_AddArrayToObject(json, "ZSTD_FRAMES");
+
+    while (at + 4 <= len) {
+        size_t csize, dsize, decompressed = 0;
+        unsigned char *dst;
+
+        frame_json = cJSON_CreateObject();
+        cJSON_AddItemToArray(frames_json, frame_json);
+
+        /* the decoder exits the process on corrupt input unless the
+           recovery point is armed; arm it so the host survives and gets
+           the structure decoded so far plus an error return */
+        if (setjmp(zdec_recover_env)) {
+            zdec_recover_armed = 0;
+            cJSON_AddStringToObject(frame_json, "DECODE_ERROR",
+                                    zdec_error_msg);
+            ret = -1;
+            break;
+        }
+        zdec_recover_armed = 1;
+        csize = ZSTD_get_frame_compressed_size(buf + at, len - at);
+
+        if ((cfe_le32(buf + at) & 0xFFFFFFF0U) == 0x184D2A50U) {
+            /* skippable frame: no content to decompress */
+            cJSON* skippable_json = cJSON_AddObjectToObject(frame_json,
+                                                            "SKIPPABLE_FRAME");
+            cJSON_AddNumberToObject(skippable_json, "MAGIC_NUMBER",
+                                    cfe_le32(buf + at));
+            cJSON_AddNumberToObject(skippable_json, "FRAME_SIZE",
+                                    cfe_le32(buf + at + 4));
+        } else {
+            dsize = ZSTD_get_decompressed_size(buf + at, len - at);
+            if (dsize == (size_t)-1)
+                dsize = MAX_COMPRESSION_RATIO * csize;
+            dst = malloc(dsize);
+            if (dst == NULL) {
+                zdec_recover_armed = 0;
+                ret = -1;
+                break;
+            }
+            ZSTD_decompress_with_dict(dst, dsize, buf + at, csize, NULL,
+                                      frame_json, &decompressed);
+            free(dst);
+        }
+        zdec_recover_armed = 0;
+        at += csize;
+    }
+    zdec_recover_armed = 0;
+    cfe_emit_tree(writer, user, json);
+    return ret;
+}
+
+/* Size of the lz4 frame header at buf, or 0 when malformed */
+static size_t cfe_lz4_header_size(const unsigned char *buf, size_t len)
+{
+    size_t at = 7;
+
+    if (len < 7)
+        return 0;
+    if (buf[4] & 0x08)                  /* content size field */
+        at += 8;
+    if (buf[4] & 0x01)                  /* dictionary id */
+        at += 4;
+    return at > len ? 0 : at;
+}
+
+int cfe_dump_lz4(const unsigned char *buf, size_t len,
+                 const cfe_writer_t *writer, void *user)
+{
+    size_t at, header_size;
+    int block_checksum, ret = 0;
+    cJSON *json, *header_json, *blocks_json, *block_json;
+
+    if (cfe_identify(buf, len) != CFE_FORMAT_LZ4)
+        return -1;
+    header_size = cfe_lz4_header_size(buf, len);
+    if (header_size == 0)
+        return -1;
+    json = cJSON_CreateObject();
+    if (json == NULL)
+        return -1;
+
+    header_json = cJSON_AddObjectToObject(json, "LZ4_HEADER");
+    cJSON_AddNumberToObject(header_json, "MAGIC_NUMBER", cfe_le32(buf));
+    cJSON_AddNumberToObject(header_json, "FLG", buf[4]);
+    cJSON_AddNumberToObject(header_json, "BD", buf[5]);
+    block_checksum = (buf[4] >> 4) & 1;
+
+    blocks_json = cJSON_AddArrayToObject(json, "LZ4_BLOCK");
+    at = header_size;
+    while (at + 4 <= len) {
+        unsigned int word = cfe_le32(buf + at);
+        unsigned int block_size = word & 0x7FFFFFFFU;
+
+        if (word == 0) {                /* EndMark */
+            at += 4;
+            if ((buf[4] & 0x04) && at + 4 <= len)
+                cJSON_AddNumberToObject(json, "CONTENT_CHECKSUM",
+                                        cfe_le32(buf + at));
+            break;
+        }
+        block_json = cJSON_CreateObject();
+        cJSON_AddItemToArray(blocks_json, block_json);
+        cJSON_AddNumberToObject(block_json, "BLOCK_BIT_POSITION",
+                                (double)(at - header_size) * 8);
+        cJSON_AddNumberToObject(block_json, "BLOCK_BIT_SIZE",
+                                (double)(block_size + 4) * 8);
+        cJSON_AddStringToObject(block_json, "COMPRESSED_FLAG",
+                                (word >> 31) ? "UNCOMPRESSED" : "COMPRESSED");
+        at += 4 + block_size + (block_checksum ? 4 : 0);
+        if (at > len) {                 /* block runs past the buffer */
+            ret = -1;
+            break;
+        }
+    }
+    cfe_emit_tree(writer, user, json);
+    return ret;
+}
+
+int cfe_dump(const unsigned char *buf, size_t len,
+             const cfe_writer_t *writer, void *user)
+{
+    switch (cfe_identify(buf, len)) {
+    case CFE_FORMAT_GZIP:
+        return cfe_dump_gzip(buf, len, writer, user);
+    case CFE_FORMAT_ZLIB:
+        return cfe_dump_zlib(buf, len, writer, user);
+    case CFE_FORMAT_ZSTD:
+        return cfe_dump_zstd(buf, len, writer, user);
+    case CFE_FORMAT_LZ4:
+        return cfe_dump_lz4(buf, len, writer, user);
+    default:
+        /* raw deflate carries no magic; try it as a best effort */
+        return cfe_dump_deflate(buf, len, writer, user);
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef _CFE_H_
+#define _CFE_H_
+
+#include <stddef.h>
+
+/* In-process dump API.  Each cfe_dump_* function decodes one buffer and
+   streams its structure as events to the caller's callbacks -- no child
+   process, no intermediate files, no JSON text to re-parse.  The decoders
+   share process-global state with the command line tools, so the API is
+   not thread safe.  Corrupt or truncated input is reported through the
+   return value after the events decoded so far have been delivered. */
+
+#define CFE_FORMAT_UNKNOWN 0
+#define CFE_FORMAT_DEFLATE 1
+#define CFE_FORMAT_ZLIB    2
+#define CFE_FORMAT_GZIP    3
+#define CFE_FORMAT_ZSTD    4
+#define CFE_FORMAT_LZ4     5
+
+/* Structure events.  name is NULL for array elements; any callback left
+   NULL skips that event kind. */
+typedef struct {
+    void (*begin_object)(void *user, const char *name);
+    void (*end_object)(void *user);
+    void (*begin_array)(void *user, const char *name);
+    void (*end_array)(void *user);
+    void (*on_number)(void *user, const char *name, double value);
+    void (*on_string)(void *user, const char *name, const char *value);
+} cfe_writer_t;
+
+/* Identify the container format from the leading magic bytes.  Raw
+   deflate has no magic, so unrecognized input returns CFE_FORMAT_UNKNOWN
+   rather than guessing. */
+int cfe_identify(const unsigned char *buf, size_t len);
+
+/* Per-format dumps; return 0 on success, nonzero on a decode error (the
+   structure decoded up to the error is still delivered). */
+int cfe_dump_deflate(const unsigned char *buf, size_t len,
+                     const cfe_writer_t *writer, void *user);
+int cfe_dump_zlib(const unsigned char *buf, size_t len,
+                  const cfe_writer_t *writer, void *user);
+int cfe_dump_gzip(const unsigned char *buf, size_t len,
+                  const cfe_writer_t *writer, void *user);
+int cfe_dump_zstd(const unsigned char *buf, size_t len,
+                  const cfe_writer_t *writer, void *user);
+int cfe_dump_lz4(const unsigned char *buf, size_t len,
+                 const cfe_writer_t *writer, void *user);
+
+/* Identify and dispatch; unknown input is tried as raw deflate. */
+int cfe_dump(const unsigned char *buf, size_t len,
+             const cfe_writer_t *writer, void *user);
+
+#endif
@@ -0,0 +1,183 @@
+/*
+ * cfe_dump.c
+ * Copyright (C) 2024 sunh20
+ * Format auto-detecting front end over libcfe.
+ *
+ * Usage: cfe_dump file [file ...]
+ *
+ * Sniffs the container magic once on the mapped input and dispatches to
+ * the matching decoder; if that decoder rejects the data, the remaining
+ * candidates are tried on the same buffer, raw deflate last since it has
+ * no magic to check.  Each input gets a <name>_compressed.json with the
+ * structure streamed through the jw_* writer, so one process and one
+ * file load replace the old try-every-tool wrapper.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "cfe.h"
+#include "utils.h"
+
+#define local static
+
+/* Writer adapter: forward events to the jw_* streaming writer.  The
+   document root object is opened by jw_begin_document already, so the
+   outermost begin/end pair from the library is swallowed. */
+typedef struct {
+    int depth;
+} jw_adapter_t;
+
+local void adapter_begin_object(void *user, const char *name)
+{
+    jw_adapter_t *adapter = (jw_adapter_t *)user;
+
+    if (adapter->depth++ > 0)
+        jw_begin_object(name);
+}
+
+local void adapter_end_object(void *user)
+{
+    jw_adapter_t *adapter = (jw_adapter_t *)user;
+
+    if (--adapter->depth > 0)
+        jw_end_object();
+}
+
+local void adapter_begin_array(void *user, const char *name)
+{
+    ((jw_adapter_t *)user)->depth++;
+    jw_begin_array(name);
+}
+
+local void adapter_end_array(void *user)
+{
+    ((jw_adapter_t *)user)->depth--;
+    jw_end_array();
+}
+
+local void adapter_add_number(void *user, const char *name, double value)
+{
+    (void)user;
+    jw_add_number(name, value);
+}
+
+local void adapter_add_string(void *user, const char *name, const char *value)
+{
+    (void)user;
+    jw_add_string(name, value);
+}
+
+local const cfe_writer_t jw_adapter_writer = {
+    adapter_begin_object, adapter_end_object,
+    adapter_begin_array, adapter_end_array,
+    adapter_add_number, adapter_add_string
+};
+
+/* Candidate decoders in the order they are tried when the sniffed format
+   fails; raw deflate must stay last since it matches no magic */
+local const struct {
+    int format;
+    const char *format_name;
+    int (*dump)(const unsigned char *buf, size_t len,
+                const cfe_writer_t *writer, void *user);
+} candidates[] = {
+    { CFE_FORMAT_GZIP,    "gzip",    cfe_dump_gzip },
+    { CFE_FORMAT_ZSTD,    "zstd",    cfe_dump_zstd },
+    { CFE_FORMAT_LZ4,     "lz4",     cfe_dump_lz4 },
+    { CFE_FORMAT_ZLIB,    "zlib",    cfe_dump_zlib },
+    { CFE_FORMAT_DEFLATE, "deflate", cfe_dump_deflate },
+};
+#define NUM_CANDIDATES (sizeof(candidates) / sizeof(candidates[0]))
+
+/* Run one candidate decoder with the JSON output (re)opened fresh, so a
+   failed attempt leaves nothing behind for the next one to append to */
+local int try_candidate(int candidate, const unsigned char *buf, size_t len,
+                        const char *json_file_name)
+{
+    FILE *json_file;
+    jw_adapter_t adapter = { 0 };
+    int ret;
+
+    json_file = fopen(json_file_name, "w");
+    if (json_file == NULL) {
+        fprintf(stderr, "could not create %s\n", json_file_name);
+        return -1;
+    }
+    jw_begin_document(json_file);
+    ret = candidates[candidate].dump(buf, len, &jw_adapter_writer, &adapter);
+    jw_end_document();
+    fclose(json_file);
+    return ret;
+}
+
+local int dump_file(const char *name)
+{
+    unsigned char *buf;
+    size_t len;
+    char json_file_name[250];
+    int format, i, first = -1, ret = -1;
+
+    buf = map_file(name, &len);
+    if (buf == NULL) {
+        fprintf(stderr, "could not open or read %s\n", name);
+        return 3;
+    }
+
+    if (strlen(name) < 200) {
+        strcpy(json_file_name, name);
+        strcat(json_file_name, "_compressed.json");
+    }
+    else
+        strcpy(json_file_name, "cfe_compressed.json");
+
+    /* sniff once, then fall back through the rest on the same buffer */
+    format = cfe_identify(buf, len);
+    for (i = 0; i < (int)NUM_CANDIDATES; i++)
+        if (candidates[i].format == format)
+            first = i;
+    if (first >= 0) {
+        ret = try_candidate(first, buf, len, json_file_name);
+        if (ret == 0)
+            printf("%s: %s -> %s\n", name, candidates[first].format_name,
+                   json_file_name);
+    }
+    if (ret != 0)
+        for (i = 0; i < (int)NUM_CANDIDATES; i++) {
+            if (i == first)
+                continue;
+            ret = try_candidate(i, buf, len, json_file_name);
+            if (ret == 0) {
+                printf("%s: %s -> %s\n", name, candidates[i].format_name,
+                       json_file_name);
+                break;
+            }
+        }
+    if (ret != 0)
+        fprintf(stderr, "%s: no decoder accepted the data\n", name);
+
+    unmap_file(buf, len);
+    return ret == 0 ? 0 : 1;
+}
+
+int main(int argc, char **argv)
+{
+    int ret = 0, any = 0;
+    char *arg;
+
+    while (arg = *++argv, --argc)
+        if (arg[0] == '-') {
+            fprintf(stderr, "invalid option %s\n", arg);
+            return 3;
+        }
+        else {
+            any = 1;
+            if (dump_file(arg))
+                ret = 1;
+        }
+
+    if (!any) {
+        fprintf(stderr, "usage: cfe_dump file [file ...]\n");
+        return 3;
+    }
+    return ret;
+}
@@ -83,40 +83,35 @@ local void *load(const char *name, size_t *len)
     return buf;
 }
 
-int main(int argc, char **argv)
+/* Dump one input file; in batch mode this is called once per listed name so
+   process startup and the allocation context are paid for only once. */
+local int dump_file(const char *name, unsigned skip, int put, int wr_file,
+                    int stream_win)
 {
-    int ret, put = 0, i, wr_file = 0;
-    unsigned skip = 0, file_name_len = 0;
-    char *arg, *name = NULL;
+    int ret, single_pass;
+    unsigned file_name_len = 0;
     unsigned char *source = NULL, *dest;
-    size_t len = 0;
-    int print_level = 0;
+    size_t len = 0, maplen = 0;
+    int source_mapped = 0;
     unsigned long sourcelen, destlen;
     char compressed_log_file_name[250] = {0};
     char decompressed_log_file_name[250] = {0};
     char decompressed_file_name[250] = {0};
+    char stream_log_file_name[250] = {0};
+    char binary_sidecar_file_name[250] = {0};
+    char stats_log_file_name[250] = {0};
+    char block_index_file_name[250] = {0};
+    FILE *stream_file = NULL;
+    cJSON *index_root_json = NULL;
 
-    /* process arguments */
-    while (arg = *++argv, --argc)
-        if (arg[0] == '-') {
-            if (arg[1] == 'w' && arg[2] == 0)
-                put = 1, wr_file = 1;
-            else if (arg[1] == 'v' && arg[2] == 0)
-                put = 1, print_data_verbose = 1;
-            else if (arg[1] >= '0' && arg[1] <= '9')
-                skip = (unsigned)atoi(arg + 1);
-            else {
-                fprintf(stderr, "invalid option %s\n", arg);
-                return 3;
-            }
-        }
-        else if (name != NULL) {
-            fprintf(stderr, "only one file name allowed\n");
-            return 3;
-        }
-        else
-            name = arg;
-    source = load(name, &len);
+    adler32_checksum = 1;
+    source = map_file(name, &maplen);
+    if (source != NULL) {
+        len = maplen;
+        source_mapped = 1;
+    } else {
+        source = load(name, &len);
+    }
     if (source == NULL) {
         fprintf(stderr, "memory allocation failure\n");
         return 4;
@@ -129,7 +124,10 @@ int main(int argc, char **argv)
     }
     if (skip >= len) {
         fprintf(stderr, "skip request of %d leaves no input\n", skip);
-        free(source);
+        if (source_mapped)
+            unmap_file(source, maplen);
+        else
+            free(source);
         return 3;
     }
 
@@ -138,22 +136,76 @@ int main(int argc, char **argv)
         strcpy(compressed_log_file_name, name);
         strcpy(decompressed_log_file_name, name);
         strcpy(decompressed_file_name, name);
-        strcat (compressed_log_file_name, "_compressed.json");
-        strcat (decompressed_log_file_name, "_decompressed.json");
+        strcpy(stream_log_file_name, name);
+        strcpy(binary_sidecar_file_name, name);
+        strcpy(stats_log_file_name, name);
+        strcpy(block_index_file_name, name);
+        strcat (compressed_log_file_name, binary_format_enable ?
+                "_compressed.cfb" : "_compressed.json");
+        strcat (decompressed_log_file_name, binary_format_enable ?
+                "_decompressed.cfb" : "_decompressed.json");
         strcat (decompressed_file_name, "_decompressed.bin");
+        strcat (stream_log_file_name, "_stream.json");
+        strcat (binary_sidecar_file_name, "_data.bin");
+        strcat (stats_log_file_name, "_stats.json");
+        strcat (block_index_file_name, binary_format_enable ?
+                "_index.cfb" : "_index.json");
     } else {
-        strcat (compressed_log_file_name, "deflate_compressed.json");
-        strcat (decompressed_log_file_name, "deflate_decompressed.json");
+        strcat (compressed_log_file_name, binary_format_enable ?
+                "deflate_compressed.cfb" : "deflate_compressed.json");
+        strcat (decompressed_log_file_name, binary_format_enable ?
+                "deflate_decompressed.cfb" : "deflate_decompressed.json");
         strcat (decompressed_file_name, "deflate_decompressed.bin");
+        strcat (stream_log_file_name, "deflate_stream.json");
+        strcat (binary_sidecar_file_name, "deflate_data.bin");
+        strcat (stats_log_file_name, "deflate_stats.json");
+        strcat (block_index_file_name, binary_format_enable ?
+                "deflate_index.cfb" : "deflate_index.json");
+    }
+
+    if (json_stream_enable) {
+        stream_file = fopen(stream_log_file_name, "w");
+        jw_begin_document(stream_file);
+    }
+
+    if (binary_sidecar_enable) {
+        binary_sidecar_file = fopen(binary_sidecar_file_name, "wb");
+        output_buffer_attach(binary_sidecar_file);
+        binary_sidecar_offset = 0;
     }
 
     /* test inflate data with offset skip */
     len -= skip;
     sourcelen = (unsigned long)len;
 
+    json_arena_init();
+
+    if (stats_enable) {
+        stats_reset();
+        stats_in_bytes = len;
+    }
+
+    /* without -v both JSON files carry the same block structure, so the
+       output can be produced in the same decode that builds the JSON and
+       the second full decode is skipped entirely */
+    single_pass = put && !print_data_verbose;
+    if (single_pass) {
+        decompressed_data_file = fopen(decompressed_file_name, "wb");
+        stream_window_enable = 1;
+    }
+
     compressed_data_log_file = fopen(compressed_log_file_name, "w");
     compressed_data_json = cJSON_CreateObject();
 
+    if (block_index_enable) {
+        index_root_json = cJSON_CreateObject();
+        cJSON_AddStringToObject(index_root_json, "window_note",
+                                "entries hold no window snapshot; a restart "
+                                "at an entry must first reconstruct output "
+                                "from its window_from byte onward");
+        block_index_json = cJSON_AddArrayToObject(index_root_json, "BLOCK_INDEX");
+    }
+
     ret = puff(NIL, &destlen, source + skip, &sourcelen, compressed_data_json);
     if (ret)
         fprintf(stderr, "puff() failed with return code %d\n", ret);
@@ -161,27 +213,68 @@ int main(int argc, char **argv)
         fprintf(stderr, "puff() succeeded uncompressing %lu bytes\n", destlen);
         if (sourcelen < len) fprintf(stderr, "%lu compressed bytes unused\n",
                                      len - sourcelen);
+        stats_out_bytes = destlen;
     }
 
     cJSON_AddNumberToObject(compressed_data_json, "JSON_END", 0);
 
-    char* jsonString = cJSON_Print(compressed_data_json);
-    if (compressed_data_log_file) {
-        fprintf(compressed_data_log_file, "%s", jsonString);
+    double stats_t0 = stats_enable ? stats_now() : 0;
+    write_json_to_file(compressed_data_json, compressed_data_log_file);
+    if (stats_enable)
+        stats_json_write_time += stats_now() - stats_t0;
+
+    if (single_pass) {
+        stream_window_enable = 0;
+        fclose(decompressed_data_file);
+        decompressed_data_file = NULL;
+        if (ret == 0) {
+            /* reuse the tree for the decompressed log, plus the checksum
+               computed during the decode above */
+            decompressed_data_log_file = fopen(decompressed_log_file_name, "w");
+            cJSON* checksum_calculated_json = cJSON_AddObjectToObject(compressed_data_json, "CHECKSUM_CALCULATED");
+            adler32_checksum = swap_uint32(adler32_checksum);
+            dump_data_to_json(compressed_data_json, "value", (unsigned char*)&adler32_checksum, 4);
+            cJSON_AddStringToObject(checksum_calculated_json, "description", "Adler-32 Checksum Calculated");
+            stats_t0 = stats_enable ? stats_now() : 0;
+            write_json_to_file(compressed_data_json, decompressed_data_log_file);
+            if (stats_enable)
+                stats_json_write_time += stats_now() - stats_t0;
+            fclose(decompressed_data_log_file);
+            decompressed_data_log_file = NULL;
+        }
+    }
+
+    /* the index entries live in the arena with the rest of the tree, so
+       the compact sidecar has to go out before the release below */
+    if (index_root_json != NULL) {
+        FILE *index_file = fopen(block_index_file_name, "w");
+        write_json_to_file_compact(index_root_json, index_file);
+        fclose(index_file);
+        block_index_json = NULL;
+        index_root_json = NULL;
     }
-    cJSON_free(jsonString);
-    cJSON_Delete(compressed_data_json);
+
+    json_arena_release();
     fclose(compressed_data_log_file);
     compressed_data_log_file = NULL;
     compressed_data_json = NULL;
 
     /* if requested, inflate again and write decompressed data to stdout */
-    if (put && ret == 0) {
-        dest = malloc(destlen);
-        if (dest == NULL) {
-            fprintf(stderr, "memory allocation failure\n");
-            return 4;
+    if (put && ret == 0 && !single_pass) {
+        if (stream_win) {
+            /* stream through puff's 32K window straight into the output
+               file, so memory stays constant however large the content */
+            decompressed_data_file = fopen(decompressed_file_name, "wb");
+            stream_window_enable = 1;
+            dest = NIL;
+        }
+        else {
+            dest = malloc(destlen);
+            if (dest == NULL) {
+                fprintf(stderr, "memory allocation failure\n");
+                return 4;
 
+            }
         }
         decompressed_data_log_file = fopen(decompressed_log_file_name, "w");
         decompressed_data_json = cJSON_CreateObject();
@@ -192,25 +285,147 @@ int main(int argc, char **argv)
         dump_data_to_json(decompressed_data_json, "value", (unsigned char*)&adler32_checksum, 4);
         cJSON_AddStringToObject(checksum_calculated_json, "description", "Adler-32 Checksum Calculated");
 
-        char* jsonString = cJSON_Print(decompressed_data_json);
-        if (decompressed_data_log_file) {
-            fprintf(decompressed_data_log_file, "%s", jsonString);
-        }
-        cJSON_free(jsonString);
-        cJSON_Delete(decompressed_data_json);
+        double stats_t1 = stats_enable ? stats_now() : 0;
+        write_json_to_file(decompressed_data_json, decompressed_data_log_file);
+        if (stats_enable)
+            stats_json_write_time += stats_now() - stats_t1;
+        json_arena_release();
         fclose(decompressed_data_log_file);
         decompressed_data_log_file = NULL;
         decompressed_data_json = NULL;
 
-        if (wr_file) {
+        if (stream_win) {
+            stream_window_enable = 0;
+            fclose(decompressed_data_file);
+            decompressed_data_file = NULL;
+        }
+        else if (wr_file) {
             decompressed_data_file = fopen(decompressed_file_name, "wb");
             fwrite(dest, 1, destlen, decompressed_data_file);
             fclose(decompressed_data_file);
+            decompressed_data_file = NULL;
         }
         free(dest);
     }
 
+    if (stream_file) {
+        jw_end_document();
+        fclose(stream_file);
+    }
+
+    if (binary_sidecar_file) {
+        fclose(binary_sidecar_file);
+        binary_sidecar_file = NULL;
+    }
+
+    if (stats_enable)
+        stats_dump(stats_log_file_name);
+
     /* clean up */
-    free(source);
+    if (source_mapped)
+        unmap_file(source, maplen);
+    else
+        free(source);
     return ret;
 }
+
+/* Read the next file name from a batch list.  Names are separated by
+   newlines or NULs so both plain lists and find -print0 output work. */
+local int next_list_name(FILE *list, char *name, size_t size)
+{
+    int c;
+    size_t n = 0;
+
+    while ((c = getc(list)) != EOF) {
+        if (c == '\n' || c == '\r' || c == '\0') {
+            if (n)
+                break;
+            continue;
+        }
+        if (n + 1 < size)
+            name[n++] = c;
+    }
+    name[n] = 0;
+    return n > 0;
+}
+
+int main(int argc, char **argv)
+{
+    int ret = 0, put = 0, wr_file = 0, batch = 0, stream_win = 0;
+    unsigned skip = 0;
+    char *arg, *name = NULL;
+
+    /* process arguments */
+    while (arg = *++argv, --argc)
+        if (arg[0] == '-') {
+            if (arg[1] == 'w' && arg[2] == 0)
+                put = 1, wr_file = 1;
+            else if (arg[1] == 'v' && arg[2] == 0)
+                put = 1, print_data_verbose = 1;
+            else if (arg[1] == 'd' && arg[2] >= '0' && arg[2] <= '3'
+                     && arg[3] == 0)
+                put = 1, print_data_verbose = 1,
+                    print_detail_level = arg[2] - '0';
+            else if (arg[1] == 's' && arg[2] == 0)
+                json_stream_enable = 1;
+            else if (strcmp(arg, "--scan") == 0)
+                scan_only = 1;
+            else if (strcmp(arg, "--stats") == 0)
+                stats_enable = 1;
+            else if (strcmp(arg, "--index") == 0)
+                block_index_enable = 1;
+            else if (strcmp(arg, "--range") == 0 && argc > 1) {
+                char *colon;
+                arg = *++argv, --argc;
+                range_offset = strtoul(arg, &colon, 0);
+                if (*colon != ':') {
+                    fprintf(stderr, "invalid --range, expected OFFSET:LEN\n");
+                    return 3;
+                }
+                range_len = strtoul(colon + 1, NULL, 0);
+                range_enable = 1;
+            }
+            else if (strcmp(arg, "--tolerant") == 0)
+                tolerant_enable = 1;
+            else if (strcmp(arg, "--format=binary") == 0)
+                binary_format_enable = 1;
+            else if (arg[1] == 'b' && arg[2] == 0)
+                binary_sidecar_enable = 1;
+            else if (arg[1] == 'B' && arg[2] == 0)
+                batch = 1;
+            else if (arg[1] == 'W' && arg[2] == 0)
+                put = 1, stream_win = 1;
+            else if (arg[1] >= '0' && arg[1] <= '9')
+                skip = (unsigned)atoi(arg + 1);
+            else {
+                fprintf(stderr, "invalid option %s\n", arg);
+                return 3;
+            }
+        }
+        else if (name != NULL) {
+            fprintf(stderr, "only one file name allowed\n");
+            return 3;
+        }
+        else
+            name = arg;
+
+    /* batch mode: the name is a list of inputs (or the list comes from
+       stdin) and each entry gets its own dump in this one process */
+    if (batch) {
+        char list_name[250];
+        FILE *list = name == NULL ? stdin : fopen(name, "r");
+
+        if (list == NULL) {
+            fprintf(stderr, "could not open file list %s\n", name);
+            return 3;
+        }
+        while (next_list_name(list, list_name, sizeof(list_name)))
+            if (dump_file(list_name, skip, put, wr_file, stream_win))
+                ret = 1;
+        if (list != stdin)
+            fclose(list);
+        return ret;
+    }
+
+    return dump_file(name, skip, put, wr_file, stream_win);
+}
@@ -30,6 +30,11 @@
 #  define SET_BINARY_MODE(file)
 #endif
 
+#if !defined(_WIN32) && !defined(WIN32)
+#  include <pthread.h>
+#  define HAVE_MEMBER_WORKERS 1
+#endif
+
 #define local static
 
 /* Return size times approximately the cube root of 2, keeping the result as 1,
@@ -373,8 +378,8 @@ int gzip_dump(unsigned char *dest,
         cJSON_AddStringToObject(checksum_in_file_json, "description", "CRC-32 Checksum in File");
         if (dest) {
             cJSON* checksum_calculated_json = cJSON_AddObjectToObject(gzip_format_json, "CHECKSUM_CALCULATED");
-            adler32_checksum = swap_uint32(adler32_checksum);
-            dump_data_to_json(checksum_calculated_json, "value", (unsigned char *)&adler32_checksum, 4);
+            unsigned int crc32_final = crc32_checksum ^ 0xFFFFFFFFU;
+            dump_data_to_json(checksum_calculated_json, "value", (unsigned char *)&crc32_final, 4);
             cJSON_AddStringToObject(checksum_calculated_json, "description", "CRC-32 Checksum Calculated");
         }
 
@@ -388,37 +393,215 @@ int gzip_dump(unsigned char *dest,
     return ret;
 }
 
-int main(int argc, char **argv)
+/* Find the next gzip member start candidate at or after offset from.
+   Members begin with the fixed ID1/ID2/CM bytes; the flag byte's reserved
+   bits must be zero and XFL is one of the values deflate actually emits,
+   which filters most chance matches inside compressed data.  Matches can
+   still be false hits inside payload bytes, so candidates are never
+   trusted directly: the pre-scan in dump_file() measures where each
+   member really ends with a decode.  Returns len when no further
+   candidates. */
+local size_t next_member_offset(const unsigned char *source, size_t len,
+                                size_t from)
+{
+    size_t at;
+
+    for (at = from; at + 10 <= len; at++)
+        if (source[at] == 0x1f && source[at + 1] == 0x8b &&
+            source[at + 2] == 8 && (source[at + 3] & 0xe0) == 0 &&
+            (source[at + 8] == 0 || source[at + 8] == 2 ||
+             source[at + 8] == 4))
+            return at;
+    return len;
+}
+
+/* Size of the variable-length member header starting at source, or 0 when
+   it is not a plausible member start or the header runs past the end.
+   Used by the measuring pre-scan to find where the deflate data begins. */
+local size_t member_header_size(const unsigned char *source, size_t len)
+{
+    unsigned char flags;
+    size_t at = 10;
+
+    if (len < 10 || source[0] != 0x1f || source[1] != 0x8b || source[2] != 8)
+        return 0;
+    flags = source[3];
+    if (flags & 4) {                    /* FEXTRA */
+        if (at + 2 > len)
+            return 0;
+        at += 2 + ((size_t)source[at] | ((size_t)source[at + 1] << 8));
+    }
+    if (flags & 8) {                    /* FNAME */
+        while (at < len && source[at])
+            at++;
+        at++;
+    }
+    if (flags & 16) {                   /* FCOMMENT */
+        while (at < len && source[at])
+            at++;
+        at++;
+    }
+    if (flags & 2)                      /* FHCRC */
+        at += 2;
+    return at > len ? 0 : at;
+}
+
+
+/* State sidecar for --incr: magic, verified prefix length, member count
+   and a probe hash, host endian, so the next run over an append-only log
+   can skip everything it already dumped */
+#define INCR_STATE_MAGIC 0x31524349U   /* "ICR1" */
+
+/* FNV-1a over a probe window at each end of the prefix -- enough to catch
+   a rewritten or truncated log without rereading gigabytes */
+local unsigned int incr_probe_hash(const unsigned char *source, size_t prefix_len)
+{
+    unsigned int hash = 2166136261U;
+    size_t probe = prefix_len < 4096 ? prefix_len : 4096;
+    size_t i;
+
+    for (i = 0; i < probe; i++) {
+        hash ^= source[i];
+        hash *= 16777619U;
+    }
+    for (i = prefix_len - probe; i < prefix_len; i++) {
+        hash ^= source[i];
+        hash *= 16777619U;
+    }
+    return hash;
+}
+
+local int save_incr_state(const char *file_name, const unsigned char *source,
+                          size_t prefix_len, int num_members)
+{
+    unsigned int magic = INCR_STATE_MAGIC;
+    unsigned long long length = prefix_len;
+    unsigned int count = num_members;
+    unsigned int hash = incr_probe_hash(source, prefix_len);
+    FILE *state = fopen(file_name, "wb");
+
+    if (state == NULL)
+        return 0;
+    if (fwrite(&magic, sizeof(magic), 1, state) != 1 ||
+        fwrite(&length, sizeof(length), 1, state) != 1 ||
+        fwrite(&count, sizeof(count), 1, state) != 1 ||
+        fwrite(&hash, sizeof(hash), 1, state) != 1) {
+        fclose(state);
+        remove(file_name);
+        return 0;
+    }
+    fclose(state);
+    return 1;
+}
+
+/* Load the previous run's state and verify it against the current file.
+   Returns the verified prefix length, or 0 when the state is missing,
+   stale or does not match, in which case a full dump is done. */
+local size_t load_incr_state(const char *file_name, const unsigned char *source,
+                             size_t len)
 {
-    int ret, put = 0, i, wr_file = 0;
+    unsigned int magic, count, hash;
+    unsigned long long length;
+    FILE *state = fopen(file_name, "rb");
+
+    if (state == NULL)
+        return 0;
+    if (fread(&magic, sizeof(magic), 1, state) != 1 ||
+        magic != INCR_STATE_MAGIC ||
+        fread(&length, sizeof(length), 1, state) != 1 ||
+        length == 0 || length > len ||
+        fread(&count, sizeof(count), 1, state) != 1 ||
+        fread(&hash, sizeof(hash), 1, state) != 1 ||
+        hash != incr_probe_hash(source, (size_t)length)) {
+        fclose(state);
+        return 0;
+    }
+    fclose(state);
+    return (size_t)length;
+}
+
+/* One independent gzip member of a concatenated input, with its input
+   slice and private JSON sub-tree so members can be decoded on worker
+   threads and merged in order afterwards */
+typedef struct {
+    size_t offset;
+    size_t csize;
+    const unsigned char *src;
+    cJSON *json;
+    unsigned long destlen;
+    unsigned int crc_calculated;
+    int in_range;
+    int ret;
+} member_job_s;
+
+#ifdef HAVE_MEMBER_WORKERS
+typedef struct {
+    member_job_s *jobs;
+    int num_jobs;
+    int next_job;
+    pthread_mutex_t lock;
+} member_pool_s;
+
+static void *member_worker(void *arg)
+{
+    member_pool_s *const pool = arg;
+    int job_index;
+
+    for (;;) {
+        pthread_mutex_lock(&pool->lock);
+        job_index = pool->next_job++;
+        pthread_mutex_unlock(&pool->lock);
+        if (job_index >= pool->num_jobs)
+            return NULL;
+
+        member_job_s *const job = &pool->jobs[job_index];
+        job->ret = gzip_dump(NIL, &job->destlen, job->src, job->csize,
+                             job->json);
+    }
+}
+#endif
+
+/* Dump one input file; in batch mode this is called once per listed name so
+   process startup and the allocation context are paid for only once. */
+local int dump_file(const char *name, int put, int wr_file, int stream_win,
+                    int num_threads, int incremental)
+{
+    int ret = 0, single_pass, i;
+    int num_members = 0, member_cap = 0;
+    size_t member_start;
+    member_job_s *members = NULL, *member_grow;
+    unsigned long total_written;
     unsigned file_name_len = 0;
-    char *arg, *name = NULL;
     unsigned char *source = NULL, *dest;
-    size_t len = 0;
+    size_t len = 0, maplen = 0;
+    int source_mapped = 0;
     unsigned long destlen;
     char compressed_log_file_name[250] = {0};
     char decompressed_log_file_name[250] = {0};
     char decompressed_file_name[250] = {0};
+    char stream_log_file_name[250] = {0};
+    char binary_sidecar_file_name[250] = {0};
+    char stats_log_file_name[250] = {0};
+    char block_index_file_name[250] = {0};
+    char incr_state_file_name[250] = {0};
+    FILE *stream_file = NULL;
+    cJSON *index_root_json = NULL;
+    int incr_ranged = 0;
+    unsigned char scan_hold = 0, stream_hold = 0, sidecar_hold = 0,
+        index_hold = 0, stats_hold = 0, tolerant_hold = 0, range_hold = 0;
+    unsigned int adler_hold = 0, crc_hold = 0;
 
-    /* process arguments */
-    while (arg = *++argv, --argc)
-        if (arg[0] == '-') {
-            if (arg[1] == 'w' && arg[2] == 0)
-                put = 1, wr_file = 1;
-            else if (arg[1] == 'v' && arg[2] == 0)
-                put = 1, print_data_verbose = 1;
-            else {
-                fprintf(stderr, "invalid option %s\n", arg);
-                return 3;
-            }
-        }
-        else if (name != NULL) {
-            fprintf(stderr, "only one file name allowed\n");
-            return 3;
-        }
-        else
-            name = arg;
-    source = load(name, &len);
+
+    adler32_checksum = 1;
+    crc32_checksum = 0xFFFFFFFFU;
+    crc32_enable = 1;
+    source = map_file(name, &maplen);
+    if (source != NULL) {
+        len = maplen;
+        source_mapped = 1;
+    } else {
+        source = load(name, &len);
+    }
     if (source == NULL) {
         fprintf(stderr, "memory allocation failure\n");
         return 4;
@@ -435,61 +618,510 @@ int main(int argc, char **argv)
         strcpy(compressed_log_file_name, name);
         strcpy(decompressed_log_file_name, name);
         strcpy(decompressed_file_name, name);
-        strcat (compressed_log_file_name, "_compressed.json");
-        strcat (decompressed_log_file_name, "_decompressed.json");
+        strcpy(stream_log_file_name, name);
+        strcpy(binary_sidecar_file_name, name);
+        strcpy(stats_log_file_name, name);
+        strcpy(block_index_file_name, name);
+        strcpy(incr_state_file_name, name);
+        strcat (compressed_log_file_name, binary_format_enable ?
+                "_compressed.cfb" : "_compressed.json");
+        strcat (decompressed_log_file_name, binary_format_enable ?
+                "_decompressed.cfb" : "_decompressed.json");
         strcat (decompressed_file_name, "_decompressed.bin");
+        strcat (stream_log_file_name, "_stream.json");
+        strcat (binary_sidecar_file_name, "_data.bin");
+        strcat (stats_log_file_name, "_stats.json");
+        strcat (block_index_file_name, binary_format_enable ?
+                "_index.cfb" : "_index.json");
+        strcat (incr_state_file_name, "_incr.bin");
     } else {
-        strcat (compressed_log_file_name, "gzip_compressed.json");
-        strcat (decompressed_log_file_name, "gzip_decompressed.json");
+        strcat (compressed_log_file_name, binary_format_enable ?
+                "gzip_compressed.cfb" : "gzip_compressed.json");
+        strcat (decompressed_log_file_name, binary_format_enable ?
+                "gzip_decompressed.cfb" : "gzip_decompressed.json");
         strcat (decompressed_file_name, "gzip_decompressed.bin");
+        strcat (stream_log_file_name, "gzip_stream.json");
+        strcat (binary_sidecar_file_name, "gzip_data.bin");
+        strcat (stats_log_file_name, "gzip_stats.json");
+        strcat (block_index_file_name, binary_format_enable ?
+                "gzip_index.cfb" : "gzip_index.json");
+        strcat (incr_state_file_name, "gzip_incr.bin");
+    }
+
+    if (json_stream_enable) {
+        stream_file = fopen(stream_log_file_name, "w");
+        jw_begin_document(stream_file);
+    }
+
+    if (binary_sidecar_enable) {
+        binary_sidecar_file = fopen(binary_sidecar_file_name, "wb");
+        output_buffer_attach(binary_sidecar_file);
+        binary_sidecar_offset = 0;
+    }
+
+    /* the arena bump allocator is not thread safe, so parallel decodes
+       keep the system allocator */
+    if (num_threads <= 1)
+        json_arena_init();
+
+    if (stats_enable) {
+        stats_reset();
+        stats_in_bytes = len;
+    }
+
+    /* pre-scan for member boundaries, so concatenated inputs (rotated log
+       captures are typically hundreds of members) can be split into
+       independent decode jobs.  Candidates from the byte scan can be
+       false hits inside payload data, so when any exist the real end of
+       each member is measured with a structure-only decode and the next
+       member starts where the previous one actually ended; single-member
+       inputs (no later candidates) skip the measuring decodes */
+    int multi_candidates = next_member_offset(source, len, 20) < len;
+    if (multi_candidates) {
+        /* mask everything the measuring decodes would otherwise emit or
+           clobber; the real decodes below restore and redo it all */
+        scan_hold = scan_only, stream_hold = json_stream_enable;
+        sidecar_hold = binary_sidecar_enable, index_hold = block_index_enable;
+        stats_hold = stats_enable, tolerant_hold = tolerant_enable;
+        range_hold = range_enable;
+        adler_hold = adler32_checksum;
+        crc_hold = crc32_checksum;
+        scan_only = 1;
+        json_stream_enable = 0;
+        binary_sidecar_enable = 0;
+        block_index_enable = 0;
+        stats_enable = 0;
+        tolerant_enable = 0;
+        range_enable = 0;
+    }
+    member_start = 0;
+    while (member_start < len) {
+        size_t member_end = len;
+        size_t header_size;
+
+        if (num_members == member_cap) {
+            member_cap = member_cap ? member_cap * 2 : 16;
+            member_grow = realloc(members, member_cap * sizeof(member_job_s));
+            if (member_grow == NULL) {
+                fprintf(stderr, "memory allocation failure\n");
+                free(members);
+                return 4;
+            }
+            members = member_grow;
+        }
+        members[num_members].offset = member_start;
+        members[num_members].src = source + member_start;
+        if (multi_candidates &&
+            (header_size = member_header_size(source + member_start,
+                                              len - member_start)) != 0) {
+            unsigned long measured_in = len - member_start - header_size;
+            unsigned long measured_out = 0;
+            cJSON *measure_json = cJSON_CreateObject();
+            int err = puff(NIL, &measured_out,
+                           source + member_start + header_size,
+                           &measured_in, measure_json);
+
+            cJSON_Delete(measure_json);
+            if (err == 0) {
+                member_end = member_start + header_size + measured_in + 8;
+                if (member_end > len)
+                    member_end = len;
+            }
+            /* an undecodable member keeps the rest as one slice, so the
+               real decode below reports the error at the right offset */
+        }
+        members[num_members].csize = member_end - member_start;
+        num_members++;
+        member_start = member_end;
+    }
+    if (multi_candidates) {
+        scan_only = scan_hold;
+        json_stream_enable = stream_hold;
+        binary_sidecar_enable = sidecar_hold;
+        block_index_enable = index_hold;
+        stats_enable = stats_hold;
+        tolerant_enable = tolerant_hold;
+        range_enable = range_hold;
+        adler32_checksum = adler_hold;
+        crc32_checksum = crc_hold;
+    }
+
+    /* --incr: if the previous run's verified prefix still matches, decode
+       only the members appended since then by reusing the range gate */
+    if (incremental && !range_enable) {
+        size_t prefix_len = load_incr_state(incr_state_file_name, source, len);
+        int at_boundary = prefix_len == len;
+        for (i = 0; i < num_members && prefix_len; i++)
+            if (members[i].offset == prefix_len)
+                at_boundary = 1;
+        if (prefix_len && at_boundary) {
+            range_enable = 1;
+            range_offset = prefix_len;
+            range_len = len - prefix_len;
+            incr_ranged = 1;
+            fprintf(stderr, "incremental: skipping verified prefix of %lu bytes\n",
+                    (unsigned long)prefix_len);
+        } else if (prefix_len) {
+            fprintf(stderr, "incremental state does not end on a member boundary, doing a full dump\n");
+        } else {
+            fprintf(stderr, "no usable incremental state, doing a full dump\n");
+        }
+    }
+
+    /* without -v both JSON files carry the same block structure, so the
+       output can be produced in the same decode that builds the JSON and
+       the second full decode is skipped entirely */
+    single_pass = put && !print_data_verbose;
+    if (single_pass) {
+        decompressed_data_file = fopen(decompressed_file_name, "wb");
+        stream_window_enable = 1;
     }
 
     compressed_data_log_file = fopen(compressed_log_file_name, "w");
     compressed_data_json = cJSON_CreateObject();
 
-    ret = gzip_dump(NIL, &destlen, source, len, compressed_data_json);
+    if (block_index_enable) {
+        index_root_json = cJSON_CreateObject();
+        cJSON_AddStringToObject(index_root_json, "window_note",
+                                "entries hold no window snapshot; a restart "
+                                "at an entry must first reconstruct output "
+                                "from its window_from byte onward");
+        block_index_json = cJSON_AddArrayToObject(index_root_json, "BLOCK_INDEX");
+    }
 
-    char* jsonString = cJSON_Print(compressed_data_json);
-    if (compressed_data_log_file) {
-        fprintf(compressed_data_log_file, "%s", jsonString);
+    /* single-member inputs keep the original JSON layout, concatenated
+       inputs get one entry per member under GZIP_MEMBERS, in file order */
+    cJSON* members_json = NULL;
+    if (num_members > 1)
+        members_json = cJSON_AddArrayToObject(compressed_data_json, "GZIP_MEMBERS");
+    for (i = 0; i < num_members; i++) {
+        members[i].destlen = 0;
+        members[i].ret = 0;
+        members[i].in_range = !range_enable ||
+            (members[i].offset < range_offset + range_len &&
+             members[i].offset + members[i].csize > range_offset);
+        if (num_members > 1) {
+            if (members[i].in_range) {
+                members[i].json = cJSON_CreateObject();
+                cJSON_AddItemToArray(members_json, members[i].json);
+            } else {
+                members[i].json = NULL;
+            }
+        } else {
+            members[i].json = compressed_data_json;
+        }
     }
-    cJSON_free(jsonString);
-    cJSON_Delete(compressed_data_json);
+
+    /* member offsets are file absolute but puff()'s bit positions are
+       member relative, so the window gates whole members here and is
+       hidden from the deflate-level filter for the decodes below */
+    int range_active = range_enable;
+    range_enable = 0;
+
+#ifdef HAVE_MEMBER_WORKERS
+    if (num_threads > 1 && num_members > 1 && !single_pass &&
+        !json_stream_enable && !stats_enable && !binary_sidecar_enable &&
+        !block_index_enable && !range_active) {
+        /* this pass only sizes the output, so members can be decoded
+           concurrently; the single-pass window writer, the stream writer,
+           the sidecar offset and the block index array are shared state
+           and the --stats counters are unsynchronized, so those modes
+           fall through to the sequential loop below */
+        member_pool_s pool = { .jobs = members, .num_jobs = num_members,
+                               .next_job = 0 };
+        pthread_mutex_init(&pool.lock, NULL);
+        if (num_threads > num_members)
+            num_threads = num_members;
+        pthread_t* const workers = malloc(num_threads * sizeof(pthread_t));
+        if (workers == NULL) {
+            fprintf(stderr, "memory allocation failure\n");
+            return 4;
+        }
+        for (i = 0; i < num_threads; i++)
+            pthread_create(&workers[i], NULL, member_worker, &pool);
+        for (i = 0; i < num_threads; i++)
+            pthread_join(workers[i], NULL);
+        free(workers);
+        pthread_mutex_destroy(&pool.lock);
+
+        for (i = 0; i < num_members; i++)
+            if (members[i].ret)
+                ret = members[i].ret;
+    } else
+#endif
+    for (i = 0; i < num_members; i++) {
+        if (!members[i].in_range) {
+            if (range_active && members[i].offset >= range_offset + range_len)
+                break;          /* members are in file order */
+            continue;
+        }
+        if (single_pass) {
+            /* the stream window feeds the output through the running
+               checksum, so reset it per member like the second pass */
+            adler32_checksum = 1;
+            crc32_checksum = 0xFFFFFFFFU;
+        }
+        members[i].ret = gzip_dump(NIL, &members[i].destlen, members[i].src,
+                                   members[i].csize, members[i].json);
+        if (single_pass)
+            members[i].crc_calculated = crc32_checksum ^ 0xFFFFFFFFU;
+        if (members[i].ret)
+            ret = members[i].ret;
+    }
+
+    destlen = 0;
+    for (i = 0; i < num_members; i++)
+        destlen += members[i].destlen;
+    if (ret == 0)
+        stats_out_bytes = destlen;
+
+    double stats_t0 = stats_enable ? stats_now() : 0;
+    write_json_to_file(compressed_data_json, compressed_data_log_file);
+    if (stats_enable)
+        stats_json_write_time += stats_now() - stats_t0;
+
+    if (single_pass) {
+        stream_window_enable = 0;
+        fclose(decompressed_data_file);
+        decompressed_data_file = NULL;
+        if (ret == 0) {
+            /* reuse the tree for the decompressed log, plus the per-member
+               checksums computed through the stream window above; they go
+               in only now so the compressed log written before this stays
+               identical to the two-pass layout */
+            for (i = 0; i < num_members; i++) {
+                if (!members[i].in_range)
+                    continue;
+                cJSON* gzip_format_json = cJSON_GetObjectItem(members[i].json, "GZIP_FORMAT");
+                cJSON* checksum_calculated_json = cJSON_AddObjectToObject(gzip_format_json, "CHECKSUM_CALCULATED");
+                dump_data_to_json(checksum_calculated_json, "value", (unsigned char *)&members[i].crc_calculated, 4);
+                cJSON_AddStringToObject(checksum_calculated_json, "description", "CRC-32 Checksum Calculated");
+            }
+            decompressed_data_log_file = fopen(decompressed_log_file_name, "w");
+            stats_t0 = stats_enable ? stats_now() : 0;
+            write_json_to_file(compressed_data_json, decompressed_data_log_file);
+            if (stats_enable)
+                stats_json_write_time += stats_now() - stats_t0;
+            fclose(decompressed_data_log_file);
+            decompressed_data_log_file = NULL;
+        }
+    }
+
+    /* the index entries live with the rest of the tree, so the compact
+       sidecar has to go out before the tree is torn down below */
+    if (index_root_json != NULL) {
+        FILE *index_file = fopen(block_index_file_name, "w");
+        write_json_to_file_compact(index_root_json, index_file);
+        fclose(index_file);
+        block_index_json = NULL;
+        if (num_threads > 1)
+            cJSON_Delete(index_root_json);
+        index_root_json = NULL;
+    }
+
+    if (num_threads <= 1)
+        json_arena_release();
+    else
+        cJSON_Delete(compressed_data_json);
     fclose(compressed_data_log_file);
     compressed_data_log_file = NULL;
     compressed_data_json = NULL;
 
     /* if requested, inflate again and write decompressed data to stdout */
-    if (put && ret == 0) {
-        dest = malloc(destlen);
-        if (dest == NULL) {
-            fprintf(stderr, "memory allocation failure\n");
-            return 4;
+    if (put && ret == 0 && !single_pass) {
+        if (stream_win) {
+            /* stream through puff's 32K window straight into the output
+               file, so memory stays constant however large the content */
+            decompressed_data_file = fopen(decompressed_file_name, "wb");
+            stream_window_enable = 1;
+            dest = NIL;
+        }
+        else {
+            dest = malloc(destlen);
+            if (dest == NULL) {
+                fprintf(stderr, "memory allocation failure\n");
+                return 4;
+            }
         }
 
         decompressed_data_log_file = fopen(decompressed_log_file_name, "w");
         decompressed_data_json = cJSON_CreateObject();
-        gzip_dump(dest, &destlen, source, len, decompressed_data_json);
-        char* jsonString = cJSON_Print(decompressed_data_json);
-        if (decompressed_data_log_file) {
-            fprintf(decompressed_data_log_file, "%s", jsonString);
+        members_json = NULL;
+        if (num_members > 1)
+            members_json = cJSON_AddArrayToObject(decompressed_data_json, "GZIP_MEMBERS");
+        total_written = 0;
+        for (i = 0; i < num_members; i++) {
+            cJSON* member_json = decompressed_data_json;
+            unsigned long member_len = members[i].destlen;
+            if (!members[i].in_range)
+                continue;
+            if (num_members > 1) {
+                member_json = cJSON_CreateObject();
+                cJSON_AddItemToArray(members_json, member_json);
+            }
+            adler32_checksum = 1;
+            crc32_checksum = 0xFFFFFFFFU;
+            gzip_dump(dest == NIL ? NIL : dest + total_written, &member_len,
+                      members[i].src, members[i].csize, member_json);
+            total_written += member_len;
         }
-        cJSON_free(jsonString);
-        cJSON_Delete(decompressed_data_json);
+        destlen = total_written;
+        double stats_t1 = stats_enable ? stats_now() : 0;
+        write_json_to_file(decompressed_data_json, decompressed_data_log_file);
+        if (stats_enable)
+            stats_json_write_time += stats_now() - stats_t1;
+        if (num_threads <= 1)
+            json_arena_release();
+        else
+            cJSON_Delete(decompressed_data_json);
         fclose(decompressed_data_log_file);
         decompressed_data_log_file = NULL;
         decompressed_data_json = NULL;
 
-        if (wr_file) {
+        if (stream_win) {
+            stream_window_enable = 0;
+            fclose(decompressed_data_file);
+            decompressed_data_file = NULL;
+        }
+        else if (wr_file) {
             decompressed_data_file = fopen(decompressed_file_name, "wb");
             fwrite(dest, 1, destlen, decompressed_data_file);
             fclose(decompressed_data_file);
+            decompressed_data_file = NULL;
         }
 
         free(dest);
     }
 
+    if (stream_file) {
+        jw_end_document();
+        fclose(stream_file);
+    }
+
+    if (binary_sidecar_file) {
+        fclose(binary_sidecar_file);
+        binary_sidecar_file = NULL;
+    }
+
+    if (stats_enable)
+        stats_dump(stats_log_file_name);
+
+    /* record where this run ended so the next --incr run can resume */
+    if (incremental && ret == 0)
+        save_incr_state(incr_state_file_name, source, len, num_members);
+
     /* clean up */
-    free(source);
+    range_enable = range_active;
+    if (incr_ranged)
+        range_enable = 0;
+    free(members);
+    if (source_mapped)
+        unmap_file(source, maplen);
+    else
+        free(source);
     return ret;
 }
+
+/* Read the next file name from a batch list.  Names are separated by
+   newlines or NULs so both plain lists and find -print0 output work. */
+local int next_list_name(FILE *list, char *name, size_t size)
+{
+    int c;
+    size_t n = 0;
+
+    while ((c = getc(list)) != EOF) {
+        if (c == '\n' || c == '\r' || c == '\0') {
+            if (n)
+                break;
+            continue;
+        }
+        if (n + 1 < size)
+            name[n++] = c;
+    }
+    name[n] = 0;
+    return n > 0;
+}
+
+int main(int argc, char **argv)
+{
+    int ret = 0, put = 0, wr_file = 0, batch = 0, stream_win = 0;
+    int num_threads = 1, incremental = 0;
+    char *arg, *name = NULL;
+
+    /* process arguments */
+    while (arg = *++argv, --argc)
+        if (arg[0] == '-') {
+            if (arg[1] == 'w' && arg[2] == 0)
+                put = 1, wr_file = 1;
+            else if (arg[1] == 'v' && arg[2] == 0)
+                put = 1, print_data_verbose = 1;
+            else if (arg[1] == 'd' && arg[2] >= '0' && arg[2] <= '3'
+                     && arg[3] == 0)
+                put = 1, print_data_verbose = 1,
+                    print_detail_level = arg[2] - '0';
+            else if (arg[1] == 's' && arg[2] == 0)
+                json_stream_enable = 1;
+            else if (strcmp(arg, "--scan") == 0)
+                scan_only = 1;
+            else if (strcmp(arg, "--stats") == 0)
+                stats_enable = 1;
+            else if (strcmp(arg, "--index") == 0)
+                block_index_enable = 1;
+            else if (strcmp(arg, "--range") == 0 && argc > 1) {
+                char *colon;
+                arg = *++argv, --argc;
+                range_offset = strtoul(arg, &colon, 0);
+                if (*colon != ':') {
+                    fprintf(stderr, "invalid --range, expected OFFSET:LEN\n");
+                    return 3;
+                }
+                range_len = strtoul(colon + 1, NULL, 0);
+                range_enable = 1;
+            }
+            else if (strcmp(arg, "--tolerant") == 0)
+                tolerant_enable = 1;
+            else if (strcmp(arg, "--format=binary") == 0)
+                binary_format_enable = 1;
+            else if (strcmp(arg, "--incr") == 0)
+                incremental = 1;
+            else if (arg[1] == 'b' && arg[2] == 0)
+                binary_sidecar_enable = 1;
+            else if (arg[1] == 'B' && arg[2] == 0)
+                batch = 1;
+            else if (arg[1] == 'W' && arg[2] == 0)
+                put = 1, stream_win = 1;
+            else if (arg[1] == 'j' && arg[2] >= '1' && arg[2] <= '9')
+                num_threads = atoi(arg + 2);
+            else {
+                fprintf(stderr, "invalid option %s\n", arg);
+                return 3;
+            }
+        }
+        else if (name != NULL) {
+            fprintf(stderr, "only one file name allowed\n");
+            return 3;
+        }
+        else
+            name = arg;
+
+    /* batch mode: the name is a list of inputs (or the list comes from
+       stdin) and each entry gets its own dump in this one process */
+    if (batch) {
+        char list_name[250];
+        FILE *list = name == NULL ? stdin : fopen(name, "r");
+
+        if (list == NULL) {
+            fprintf(stderr, "could not open file list %s\n", name);
+            return 3;
+        }
+        while (next_list_name(list, list_name, sizeof(list_name)))
+            if (dump_file(list_name, put, wr_file, stream_win, num_threads,
+                          incremental))
+                ret = 1;
+        if (list != stdin)
+            fclose(list);
+        return ret;
+    }
+
+    return dump_file(name, put, wr_file, stream_win, num_threads, incremental);
+}
@@ -33,6 +33,7 @@
 
 unsigned char blockChecksum_g;
 unsigned char contentChecksum_g;
+unsigned char blockIndep_g;
 
 /* Return size times approximately the cube root of 2, keeping the result as 1,
    3, or 5 times a power of 2 -- the result is always > size, until the result
@@ -114,6 +115,7 @@ local unsigned decode_lz4_header(const unsigned char *source, cJSON* json)
     version = (flags >> 6) & 0x3;
     blockChecksum_g = b_checksum;
     contentChecksum_g = c_checksum;
+    blockIndep_g = b_indep;
 
     cJSON* frame_descriptor_json = cJSON_AddObjectToObject(json, "FRAME DESCRIPTOR");
     
@@ -235,7 +237,7 @@ local unsigned decode_lz4_header(const unsigned char *source, cJSON* json)
 
 int decode_lz4_block(const unsigned char *source, cJSON* json)
 {
-    unsigned int eof, block_size, byte_count;
+    unsigned int eof, block_size, byte_count, block_first;
     unsigned char compressed_flag;
     
     eof = *(unsigned int*)source;
@@ -252,6 +254,7 @@ int decode_lz4_block(const unsigned char *source, cJSON* json)
     {
         cJSON* block_json = cJSON_CreateObject();
 
+        block_first = byte_count;
         cJSON_AddNumberToObject(block_json, "BLOCK_BIT_POSITION", byte_count * 8);
 
         block_size = *(unsigned int*)source;
@@ -264,8 +267,21 @@ int decode_lz4_block(const unsigned char *source, cJSON* json)
         else if (compressed_flag == 0){
             cJSON_AddStringToObject(block_json, "COMPRESSED_FLAG", "COMPRESSED");
         }
-        // TODO decode
-        
+
+        // --index: record each block's byte offset and size so a later run
+        // can seek to it without walking every block before it
+        if (block_index_json != NULL) {
+            cJSON* index_entry_json = cJSON_CreateObject();
+            cJSON_AddNumberToObject(index_entry_json, "in_byte_offset", byte_count);
+            cJSON_AddNumberToObject(index_entry_json, "block_size", block_size);
+            cJSON_AddNumberToObject(index_entry_json, "compressed", compressed_flag == 0 ? 1 : 0);
+            cJSON_AddItemToArray(block_index_json, index_entry_json);
+        }
+        // TODO decode -- when sequence decoding lands, blocks with
+        // blockIndep_g set can be handed to a worker pool the way
+        // zstd_dump fans out frames; BLOCK_BIT_POSITION above already
+        // gives each worker its slice of the input
+
         if (blockChecksum_g == 1) {
             dump_data_to_json(block_json, "block_checksum_json", (unsigned char*)source + 4 + block_size, 4);
 
@@ -276,7 +292,12 @@ int decode_lz4_block(const unsigned char *source, cJSON* json)
         byte_count += block_size + 4;
         source += block_size + 4;
 
-        cJSON_AddItemToArray(blocks_json, block_json);
+        /* --range: the walk still has to reach the EndMark for the total
+           size, but only intersecting blocks are kept */
+        if (!range_enable ||
+            (block_first < range_offset + range_len &&
+             byte_count > range_offset))
+            cJSON_AddItemToArray(blocks_json, block_json);
     } while (*(unsigned int*) source != 0);
 
     return byte_count;
@@ -315,37 +336,35 @@ int lz4_dump(unsigned char *dest,
     return ret;
 }
 
-int main(int argc, char **argv)
+/* Dump one input file; in batch mode this is called once per listed name so
+   process startup and the allocation context are paid for only once. */
+local int dump_file(const char *name, int put, int wr_file)
 {
-    int ret, put = 0, i, wr_file = 0;
+    int ret;
     unsigned file_name_len = 0;
-    char *arg, *name = NULL;
     unsigned char *source = NULL, *dest;
-    size_t len = 0;
+    size_t len = 0, maplen = 0;
+    int source_mapped = 0;
     unsigned long destlen;
     char compressed_log_file_name[250] = {0};
     char decompressed_log_file_name[250] = {0};
     char decompressed_file_name[250] = {0};
-
-    /* process arguments */
-    while (arg = *++argv, --argc)
-        if (arg[0] == '-') {
-            if (arg[1] == 'w' && arg[2] == 0)
-                put = 1, wr_file = 1;
-            else if (arg[1] == 'v' && arg[2] == 0)
-                put = 1, print_data_verbose = 1;
-            else {
-                fprintf(stderr, "invalid option %s\n", arg);
-                return 3;
-            }
-        }
-        else if (name != NULL) {
-            fprintf(stderr, "only one file name allowed\n");
-            return 3;
-        }
-        else
-            name = arg;
-    source = load(name, &len);
+    char stream_log_file_name[250] = {0};
+    char binary_sidecar_file_name[250] = {0};
+    char stats_log_file_name[250] = {0};
+    char block_index_file_name[250] = {0};
+    FILE *stream_file = NULL;
+    cJSON *index_root_json = NULL;
+
+
+    adler32_checksum = 1;
+    source = map_file(name, &maplen);
+    if (source != NULL) {
+        len = maplen;
+        source_mapped = 1;
+    } else {
+        source = load(name, &len);
+    }
     if (source == NULL) {
         fprintf(stderr, "memory allocation failure\n");
         return 4;
@@ -362,26 +381,77 @@ int main(int argc, char **argv)
         strcpy(compressed_log_file_name, name);
         strcpy(decompressed_log_file_name, name);
         strcpy(decompressed_file_name, name);
-        strcat (compressed_log_file_name, "_compressed.json");
-        strcat (decompressed_log_file_name, "_decompressed.json");
+        strcpy(stream_log_file_name, name);
+        strcpy(binary_sidecar_file_name, name);
+        strcpy(stats_log_file_name, name);
+        strcpy(block_index_file_name, name);
+        strcat (compressed_log_file_name, binary_format_enable ?
+                "_compressed.cfb" : "_compressed.json");
+        strcat (decompressed_log_file_name, binary_format_enable ?
+                "_decompressed.cfb" : "_decompressed.json");
         strcat (decompressed_file_name, "_decompressed.bin");
+        strcat (stream_log_file_name, "_stream.json");
+        strcat (binary_sidecar_file_name, "_data.bin");
+        strcat (stats_log_file_name, "_stats.json");
+        strcat (block_index_file_name, binary_format_enable ?
+                "_index.cfb" : "_index.json");
     } else {
-        strcat (compressed_log_file_name, "lz4_compressed.json");
-        strcat (decompressed_log_file_name, "lz4_decompressed.json");
+        strcat (compressed_log_file_name, binary_format_enable ?
+                "lz4_compressed.cfb" : "lz4_compressed.json");
+        strcat (decompressed_log_file_name, binary_format_enable ?
+                "lz4_decompressed.cfb" : "lz4_decompressed.json");
         strcat (decompressed_file_name, "lz4_decompressed.bin");
+        strcat (stream_log_file_name, "lz4_stream.json");
+        strcat (binary_sidecar_file_name, "lz4_data.bin");
+        strcat (stats_log_file_name, "lz4_stats.json");
+        strcat (block_index_file_name, binary_format_enable ?
+                "lz4_index.cfb" : "lz4_index.json");
+    }
+
+    if (json_stream_enable) {
+        stream_file = fopen(stream_log_file_name, "w");
+        jw_begin_document(stream_file);
+    }
+
+    if (binary_sidecar_enable) {
+        binary_sidecar_file = fopen(binary_sidecar_file_name, "wb");
+        output_buffer_attach(binary_sidecar_file);
+        binary_sidecar_offset = 0;
+    }
+
+    json_arena_init();
+
+    if (stats_enable) {
+        stats_reset();
+        stats_in_bytes = len;
     }
 
     compressed_data_log_file = fopen(compressed_log_file_name, "w");
     compressed_data_json = cJSON_CreateObject();
 
+    if (block_index_enable) {
+        index_root_json = cJSON_CreateObject();
+        block_index_json = cJSON_AddArrayToObject(index_root_json, "BLOCK_INDEX");
+    }
+
     ret = lz4_dump(NIL, &destlen, source, len, compressed_data_json);
 
-    char* jsonString = cJSON_Print(compressed_data_json);
-    if (compressed_data_log_file) {
-        fprintf(compressed_data_log_file, "%s", jsonString);
+    double stats_t0 = stats_enable ? stats_now() : 0;
+    write_json_to_file(compressed_data_json, compressed_data_log_file);
+    if (stats_enable)
+        stats_json_write_time += stats_now() - stats_t0;
+
+    /* the index entries live in the arena with the rest of the tree, so
+       the compact sidecar has to go out before the release below */
+    if (index_root_json != NULL) {
+        FILE *index_file = fopen(block_index_file_name, "w");
+        write_json_to_file_compact(index_root_json, index_file);
+        fclose(index_file);
+        block_index_json = NULL;
+        index_root_json = NULL;
     }
-    cJSON_free(jsonString);
-    cJSON_Delete(compressed_data_json);
+
+    json_arena_release();
     fclose(compressed_data_log_file);
     compressed_data_log_file = NULL;
     compressed_data_json = NULL;
@@ -397,12 +467,11 @@ int main(int argc, char **argv)
         decompressed_data_log_file = fopen(decompressed_log_file_name, "w");
         decompressed_data_json = cJSON_CreateObject();
         lz4_dump(dest, &destlen, source, len, decompressed_data_json);
-        char* jsonString = cJSON_Print(decompressed_data_json);
-        if (decompressed_data_log_file) {
-            fprintf(decompressed_data_log_file, "%s", jsonString);
-        }
-        cJSON_free(jsonString);
-        cJSON_Delete(decompressed_data_json);
+        double stats_t1 = stats_enable ? stats_now() : 0;
+        write_json_to_file(decompressed_data_json, decompressed_data_log_file);
+        if (stats_enable)
+            stats_json_write_time += stats_now() - stats_t1;
+        json_arena_release();
         fclose(decompressed_data_log_file);
         decompressed_data_log_file = NULL;
         decompressed_data_json = NULL;
@@ -411,12 +480,123 @@ int main(int argc, char **argv)
             decompressed_data_file = fopen(decompressed_file_name, "wb");
             fwrite(dest, 1, destlen, decompressed_data_file);
             fclose(decompressed_data_file);
+            decompressed_data_file = NULL;
         }
 
         free(dest);
     }
 
+    if (stream_file) {
+        jw_end_document();
+        fclose(stream_file);
+    }
+
+    if (binary_sidecar_file) {
+        fclose(binary_sidecar_file);
+        binary_sidecar_file = NULL;
+    }
+
+    if (stats_enable)
+        stats_dump(stats_log_file_name);
+
     /* clean up */
-    free(source);
+    if (source_mapped)
+        unmap_file(source, maplen);
+    else
+        free(source);
     return ret;
 }
+
+/* Read the next file name from a batch list.  Names are separated by
+   newlines or NULs so both plain lists and find -print0 output work. */
+local int next_list_name(FILE *list, char *name, size_t size)
+{
+    int c;
+    size_t n = 0;
+
+    while ((c = getc(list)) != EOF) {
+        if (c == '\n' || c == '\r' || c == '\0') {
+            if (n)
+                break;
+            continue;
+        }
+        if (n + 1 < size)
+            name[n++] = c;
+    }
+    name[n] = 0;
+    return n > 0;
+}
+
+int main(int argc, char **argv)
+{
+    int ret = 0, put = 0, wr_file = 0, batch = 0;
+    char *arg, *name = NULL;
+
+    /* process arguments */
+    while (arg = *++argv, --argc)
+        if (arg[0] == '-') {
+            if (arg[1] == 'w' && arg[2] == 0)
+                put = 1, wr_file = 1;
+            else if (arg[1] == 'v' && arg[2] == 0)
+                put = 1, print_data_verbose = 1;
+            else if (arg[1] == 'd' && arg[2] >= '0' && arg[2] <= '3'
+                     && arg[3] == 0)
+                put = 1, print_data_verbose = 1,
+                    print_detail_level = arg[2] - '0';
+            else if (arg[1] == 's' && arg[2] == 0)
+                json_stream_enable = 1;
+            else if (strcmp(arg, "--scan") == 0)
+                scan_only = 1;
+            else if (strcmp(arg, "--stats") == 0)
+                stats_enable = 1;
+            else if (strcmp(arg, "--index") == 0)
+                block_index_enable = 1;
+            else if (strcmp(arg, "--range") == 0 && argc > 1) {
+                char *colon;
+                arg = *++argv, --argc;
+                range_offset = strtoul(arg, &colon, 0);
+                if (*colon != ':') {
+                    fprintf(stderr, "invalid --range, expected OFFSET:LEN\n");
+                    return 3;
+                }
+                range_len = strtoul(colon + 1, NULL, 0);
+                range_enable = 1;
+            }
+            else if (strcmp(arg, "--format=binary") == 0)
+                binary_format_enable = 1;
+            else if (arg[1] == 'b' && arg[2] == 0)
+                binary_sidecar_enable = 1;
+            else if (arg[1] == 'B' && arg[2] == 0)
+                batch = 1;
+            else {
+                fprintf(stderr, "invalid option %s\n", arg);
+                return 3;
+            }
+        }
+        else if (name != NULL) {
+            fprintf(stderr, "only one file name allowed\n");
+            return 3;
+        }
+        else
+            name = arg;
+
+    /* batch mode: the name is a list of inputs (or the list comes from
+       stdin) and each entry gets its own dump in this one process */
+    if (batch) {
+        char list_name[250];
+        FILE *list = name == NULL ? stdin : fopen(name, "r");
+
+        if (list == NULL) {
+            fprintf(stderr, "could not open file list %s\n", name);
+            return 3;
+        }
+        while (next_list_name(list, list_name, sizeof(list_name)))
+            if (dump_file(list_name, put, wr_file))
+                ret = 1;
+        if (list != stdin)
+            fclose(list);
+        return ret;
+    }
+
+    return dump_file(name, put, wr_file);
+}
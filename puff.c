@@ -93,6 +93,9 @@
 #define MAXDCODES 30            /* maximum number of distance codes */
 #define MAXCODES (MAXLCODES+MAXDCODES)  /* maximum codes lengths to read */
 #define FIXLCODES 288           /* number of fixed literal/length codes */
+#define FASTBITS 9              /* bits in the first-level decode table */
+
+#define WINSIZE 32768U          /* sliding window size (all MAXDIST needs) */
 
 /* input and output state */
 struct state {
@@ -100,6 +103,8 @@ struct state {
     unsigned char *out;         /* output buffer */
     unsigned long outlen;       /* available space at out */
     unsigned long outcnt;       /* bytes written to out so far */
+    unsigned char *window;      /* 32K sliding window when streaming */
+    FILE *outfile;              /* flush target for completed window data */
 
     /* input state */
     const unsigned char *in;    /* input buffer */
@@ -110,6 +115,10 @@ struct state {
 
     /* input limit error return state for bits() and decode() */
     jmp_buf env;
+
+    /* block JSON being filled in, so the recovery path can keep the
+       partially decoded block when the input runs out mid-block */
+    cJSON *block_json;
 };
 
 /*
@@ -123,12 +132,43 @@ struct state {
  *   buffer, using shift right, and new bytes are appended to the top of the
  *   bit buffer, using shift left.
  */
+local unsigned long long load64le(const unsigned char *p)
+{
+    /* the compiler reduces this to a single eight-byte load on little-endian
+       targets; the caller must ensure eight bytes remain */
+    return (unsigned long long)p[0] |
+           ((unsigned long long)p[1] << 8) |
+           ((unsigned long long)p[2] << 16) |
+           ((unsigned long long)p[3] << 24) |
+           ((unsigned long long)p[4] << 32) |
+           ((unsigned long long)p[5] << 40) |
+           ((unsigned long long)p[6] << 48) |
+           ((unsigned long long)p[7] << 56);
+}
+
 local int bits(struct state *s, int need)
 {
     long val;           /* bit accumulator (can use up to 20 bits) */
 
+    if (stats_enable) {
+        stats_bit_reader_calls++;
+        stats_bit_reader_bits += need;
+    }
+
     /* load at least need bits into val */
     val = s->bitbuf;
+    if (s->bitcnt < need && s->incnt + 8 <= s->inlen) {
+        /* bulk refill: one eight-byte load instead of a bounds check per
+           byte; only the bytes actually needed are consumed so less than
+           eight bits stay buffered and bit positions remain exact */
+        int take = (need - s->bitcnt + 7) >> 3;
+
+        val |= (long)((load64le(s->in + s->incnt) &
+                       (((unsigned long long)1 << (take << 3)) - 1))
+                      << s->bitcnt);
+        s->incnt += take;
+        s->bitcnt += take << 3;
+    }
     while (s->bitcnt < need) {
         if (s->incnt == s->inlen)
             longjmp(s->env, 1);         /* out of input */
@@ -144,6 +184,56 @@ local int bits(struct state *s, int need)
     return (int)(val & ((1L << need) - 1));
 }
 
+/*
+ * Append one byte to the output.  In streaming mode the output is a 32K
+ * sliding window -- deflate can never reference further back than MAXDIST
+ * -- and each filled window is flushed to the output file, so memory use
+ * stays constant no matter how large the content is.  The caller advances
+ * s->outcnt.
+ */
+local void out_byte(struct state *s, unsigned char val)
+{
+    if (s->window != NIL) {
+        s->window[s->outcnt & (WINSIZE - 1)] = val;
+        if ((s->outcnt & (WINSIZE - 1)) == WINSIZE - 1)
+            fwrite(s->window, 1, WINSIZE, s->outfile);
+    }
+    else
+        s->out[s->outcnt] = val;
+}
+
+/* Read the byte dist positions back in the output */
+local unsigned char out_back(struct state *s, unsigned dist)
+{
+    if (s->window != NIL)
+        return s->window[(s->outcnt - dist) & (WINSIZE - 1)];
+    return s->out[s->outcnt - dist];
+}
+
+/* Checksum the output run [first, s->outcnt).  In buffer mode the run is
+   contiguous at s->out + first; in window streaming mode it lives in the
+   circular window and may wrap once (runs fed here are shorter than
+   WINSIZE, so no byte has been overwritten yet). */
+local void checksum_output_run(struct state *s, unsigned long first)
+{
+    unsigned long len = s->outcnt - first;
+    unsigned start, n;
+
+    if (s->window == NIL) {
+        checksum_update(s->out + first, len);
+        return;
+    }
+    while (len) {
+        start = first & (WINSIZE - 1);
+        n = WINSIZE - start;
+        if (n > len)
+            n = len;
+        checksum_update(s->window + start, n);
+        first += n;
+        len -= n;
+    }
+}
+
 local int get_input_bit_position(struct state *s)
 {
     // s->incnt: current index of the s->in byte buffer.
@@ -226,28 +316,64 @@ local int stored(struct state *s, cJSON* json)
     cJSON_AddNumberToObject(nlen_json, "value", nlen);
     addStringToObjectFormatted(nlen_json, "description", "complement of LEN (65535 - %d)", len);
 
+    /* structure-only scan: account for the stored bytes without copying */
+    if (scan_only && s->out == NIL) {
+        s->incnt += len;
+        s->outcnt += len;
+        len = 0;
+    }
+
     cJSON* raw_data_json = NULL;
-    if (print_data_verbose) {
-        raw_data_json = cJSON_AddArrayToObject(json, "RAW_DATA");
+    unsigned long sidecar_start = binary_sidecar_offset;
+    if (print_data_verbose && print_detail_level >= PRINT_DETAIL_BYTES &&
+        !scan_only && !binary_sidecar_enable) {
+        if (json_stream_enable)
+            jw_begin_array("RAW_DATA");
+        else
+            raw_data_json = cJSON_AddArrayToObject(json, "RAW_DATA");
     }
 
+    /* the stored bytes are contiguous in the input, so the array can be
+       filled in one bulk append instead of one node per byte; the hooks
+       below then only serve the stream and sidecar modes */
+    if (raw_data_json != NULL) {
+        add_number_array_bulk(raw_data_json, s->in + s->incnt, len);
+        raw_data_json = NULL;
+    }
+
+    unsigned stored_first = s->incnt;
     while (len--) {
         data_val = s->in[s->incnt++];
-        print_compressed_data_hex(data_val, raw_data_json);
+        print_compressed_data_hex(data_val, raw_data_json, PRINT_DETAIL_BYTES);
 
         if (s->out != NIL) {
             if (s->outcnt + len > s->outlen) {
                 fprintf(stderr, "not enough output space!\n");
                 return 1;                      /* not enough output space */
             }
-            print_decompressed_data_hex(data_val, raw_data_json);
-            adler32(data_val);
-            s->out[s->outcnt++] = data_val;
+            print_decompressed_data_hex(data_val, raw_data_json,
+                                        PRINT_DETAIL_BYTES);
+            out_byte(s, data_val);
+            s->outcnt++;
         } else {
             s->outcnt ++;
         }
     }
 
+    /* the whole stored run is contiguous in the input, so the checksum is
+       computed over it in one block update */
+    if (s->out != NIL)
+        checksum_update(s->in + stored_first, s->incnt - stored_first);
+
+    if (print_data_verbose && print_detail_level >= PRINT_DETAIL_BYTES &&
+        !scan_only) {
+        if (binary_sidecar_enable && binary_sidecar_file)
+            sidecar_ref_to_json(json, "RAW_DATA", sidecar_start,
+                                compressed_data_log_file ? 2 : 1);
+        else if (json_stream_enable)
+            jw_end_array();
+    }
+
     /* done with a valid stored block */
     return 0;
 }
@@ -262,6 +388,12 @@ local int stored(struct state *s, cJSON* json)
 struct huffman {
     short *count;       /* number of symbols of each length */
     short *symbol;      /* canonically ordered symbols */
+
+    /* first-level lookup table, built by construct().  Indexed by the next
+       FASTBITS bits of input (first bit read in bit 0), each non-zero entry
+       is (code length << FASTBITS) | symbol for codes short enough to fit.
+       Longer codes fall back to the canonical walk in decode(). */
+    short fast[1 << FASTBITS];
 };
 
 /*
@@ -327,7 +459,48 @@ local int decode(struct state *s, const struct huffman *h)
     int bitbuf;         /* bits from stream */
     int left;           /* bits left in next or left to process */
     short *next;        /* next number of codes */
+    int entry;          /* first-level table entry */
+
+    /* refill the bit buffer so the next FASTBITS bits can be peeked, then
+       resolve short codes with a single table lookup */
+    if (s->bitcnt < FASTBITS && s->incnt + 8 <= s->inlen) {
+        int take = (FASTBITS - s->bitcnt + 7) >> 3;
+
+        s->bitbuf |= (int)((load64le(s->in + s->incnt) &
+                            (((unsigned long long)1 << (take << 3)) - 1))
+                           << s->bitcnt);
+        s->incnt += take;
+        s->bitcnt += take << 3;
+    }
+    while (s->bitcnt < FASTBITS && s->incnt < s->inlen) {
+        s->bitbuf |= (int)(s->in[s->incnt++]) << s->bitcnt;
+        s->bitcnt += 8;
+    }
+    entry = h->fast[s->bitbuf & ((1 << FASTBITS) - 1)];
+    if (entry != 0 && (entry >> FASTBITS) <= s->bitcnt) {
+        len = entry >> FASTBITS;
+        if (stats_enable) {
+            stats_bit_reader_calls++;
+            stats_bit_reader_bits += len;
+        }
+        s->bitbuf >>= len;
+        s->bitcnt -= len;
+        /* return whole unused bytes so less than eight bits stay buffered,
+           keeping stored() byte alignment and bit positions exact */
+        while (s->bitcnt >= 8) {
+            s->incnt--;
+            s->bitcnt -= 8;
+            s->bitbuf &= (1 << s->bitcnt) - 1;
+        }
+        return entry & ((1 << FASTBITS) - 1);
+    }
+    while (s->bitcnt >= 8) {
+        s->incnt--;
+        s->bitcnt -= 8;
+        s->bitbuf &= (1 << s->bitcnt) - 1;
+    }
 
+    /* long or invalid code: fall back to the canonical walk */
     bitbuf = s->bitbuf;
     left = s->bitcnt;
     code = first = index = 0;
@@ -339,6 +512,10 @@ local int decode(struct state *s, const struct huffman *h)
             bitbuf >>= 1;
             count = *next++;
             if (code - count < first) { /* if length len, return symbol */
+                if (stats_enable) {
+                    stats_bit_reader_calls++;
+                    stats_bit_reader_bits += len;
+                }
                 s->bitbuf = bitbuf;
                 s->bitcnt = (s->bitcnt - len) & 7;
                 /*print_to_compressed_log("\t\t\tencoded symbol: %d, decoded symbol: %d\n",
@@ -471,6 +648,11 @@ local int construct(struct huffman *h, const short *length, int n, cJSON* json)
     int encoded_huffman_code = 0;
     int print_count = 0;
     char encoded_huffman_code_bit_str[20] = {0};
+    int fast_len, fast_rev, fast_fill;
+    double stats_t0 = stats_enable ? stats_now() : 0;
+
+    /* invalidate the first-level table until it is rebuilt below */
+    memset(h->fast, 0, sizeof(h->fast));
 
     /* count number of codes of each length */
     for (len = 0; len <= MAXBITS; len++)
@@ -516,19 +698,36 @@ local int construct(struct huffman *h, const short *length, int n, cJSON* json)
             h->symbol[offs[length[symbol]]++] = symbol;
 
     cJSON* items_json = NULL;
-    if (print_data_verbose && compressed_data_log_file) {
+    if (print_data_verbose && print_detail_level >= PRINT_DETAIL_TABLES &&
+        compressed_data_log_file) {
         items_json = cJSON_AddArrayToObject(json, "items");
     }
 
     for (i = 0; i < encoded_symbol_num; i++) {
         encoded_huffman_code = get_encoded_val_from_huffman_table(h, h->symbol[i]);
 
+        /* enter short codes into the first-level table: the stream stores
+           code bits most significant first, so the table index is the code
+           bit-reversed, replicated across all the unused high index bits */
+        fast_len = length[h->symbol[i]];
+        if (encoded_huffman_code >= 0 && fast_len <= FASTBITS) {
+            fast_rev = 0;
+            for (j = 0; j < fast_len; j++)
+                fast_rev |= ((encoded_huffman_code >> j) & 0x1) <<
+                    (fast_len - 1 - j);
+            for (fast_fill = fast_rev; fast_fill < (1 << FASTBITS);
+                    fast_fill += 1 << fast_len)
+                h->fast[fast_fill] =
+                    (short)((fast_len << FASTBITS) | h->symbol[i]);
+        }
+
         for (j = 0; j < length[h->symbol[i]]; j++) {
             print_count += sprintf(encoded_huffman_code_bit_str + print_count, "%d",
                 (encoded_huffman_code >> (length[h->symbol[i]] -1 - j)) & 0x1);
         }
 
-        if (print_data_verbose && compressed_data_log_file) {
+        if (print_data_verbose && print_detail_level >= PRINT_DETAIL_TABLES &&
+            compressed_data_log_file) {
             cJSON* item_json = cJSON_CreateObject();
             cJSON_AddNumberToObject(item_json, "index", i);
             cJSON_AddNumberToObject(item_json, "symbol_value", h->symbol[1]);
@@ -545,6 +744,8 @@ local int construct(struct huffman *h, const short *length, int n, cJSON* json)
     }
 
     /* return zero for complete set, positive for incomplete set */
+    if (stats_enable)
+        stats_table_build_time += stats_now() - stats_t0;
     return left;
 }
 
@@ -647,13 +848,22 @@ local int codes(struct state *s,
         12, 12, 13, 13};
 
     cJSON* data_json = NULL;
-    if (print_data_verbose) {
-        if (compressed_data_log_file) {
-            data_json = cJSON_AddArrayToObject(json, "ENCODED_BIT_STREAM");
+    unsigned long sidecar_start = binary_sidecar_offset;
+    if (print_data_verbose && !scan_only && !binary_sidecar_enable) {
+        if (compressed_data_log_file &&
+            print_detail_level >= PRINT_DETAIL_SEQUENCES) {
+            if (json_stream_enable)
+                jw_begin_array("ENCODED_BIT_STREAM");
+            else
+                data_json = cJSON_AddArrayToObject(json, "ENCODED_BIT_STREAM");
         }
-        else if (decompressed_data_log_file)
+        else if (decompressed_data_log_file &&
+                 print_detail_level >= PRINT_DETAIL_BYTES)
         {
-            data_json = cJSON_AddArrayToObject(json, "DECOMPRESSED_DATA");
+            if (json_stream_enable)
+                jw_begin_array("DECOMPRESSED_DATA");
+            else
+                data_json = cJSON_AddArrayToObject(json, "DECOMPRESSED_DATA");
         }
     }
 
@@ -668,19 +878,23 @@ local int codes(struct state *s,
             leteral_symbol_total_bits +=
                 get_symbol_length_from_huffman_table(lencode, symbol);
             decoded_leteral_symbol_total_bits += 8;
-            print_compressed_data_hex(symbol, data_json);
+            print_compressed_data_hex(symbol, data_json,
+                                      PRINT_DETAIL_SEQUENCES);
             /* write out the literal */
             if (s->out != NIL) {
                 if (s->outcnt == s->outlen)
                     return 1;
-                s->out[s->outcnt] = symbol;
-                print_decompressed_data_hex(symbol, data_json);
-                adler32(symbol);
+                out_byte(s, symbol);
+                print_decompressed_data_hex(symbol, data_json,
+                                            PRINT_DETAIL_BYTES);
+                unsigned char lit_val = symbol;
+                checksum_update(&lit_val, 1);
             }
             s->outcnt++;
         }
         else if (symbol > 256) {        /* length */
-            print_compressed_data_hex(symbol, data_json);
+            print_compressed_data_hex(symbol, data_json,
+                                      PRINT_DETAIL_SEQUENCES);
             length_symbol_count++;
             distance_symbol_count++;
             length_symbol_total_bits +=
@@ -690,7 +904,8 @@ local int codes(struct state *s,
             if (symbol >= 29)
                 return -10;             /* invalid fixed code */
             len_extra = bits(s, lext[symbol]);
-            print_compressed_data_hex(len_extra, data_json);
+            print_compressed_data_hex(len_extra, data_json,
+                                      PRINT_DETAIL_SEQUENCES);
             len = lens[symbol] + len_extra;
             length_symbol_total_bits += lext[symbol];
 
@@ -698,13 +913,15 @@ local int codes(struct state *s,
             symbol = decode(s, distcode);
             if (symbol < 0)
                 return symbol;          /* invalid symbol */
-            print_compressed_data_hex(symbol, data_json);
+            print_compressed_data_hex(symbol, data_json,
+                                      PRINT_DETAIL_SEQUENCES);
 
             distance_symbol_total_bits +=
                 get_symbol_length_from_huffman_table(distcode, symbol);
 
             dist_extra = bits(s, dext[symbol]);
-            print_compressed_data_hex(dist_extra, data_json);
+            print_compressed_data_hex(dist_extra, data_json,
+                                      PRINT_DETAIL_SEQUENCES);
             dist = dists[symbol] + dist_extra;
 #ifndef INFLATE_ALLOW_INVALID_DISTANCE_TOOFAR_ARRR
             if (dist > s->outcnt) {
@@ -719,18 +936,22 @@ local int codes(struct state *s,
             if (s->out != NIL) {
                 if (s->outcnt + len > s->outlen)
                     return 1;
+                unsigned match_first = s->outcnt;
                 while (len--) {
-                    s->out[s->outcnt] =
+                    unsigned char match_val =
 #ifdef INFLATE_ALLOW_INVALID_DISTANCE_TOOFAR_ARRR
                         dist > s->outcnt ?
                             0 :
 #endif
-                            s->out[s->outcnt - dist];
-                    print_decompressed_data_hex(s->out[s->outcnt - dist],
-                        data_json);
-                    adler32(s->out[s->outcnt - dist]);
+                            out_back(s, dist);
+                    out_byte(s, match_val);
+                    print_decompressed_data_hex(match_val, data_json,
+                                                PRINT_DETAIL_BYTES);
                     s->outcnt++;
                 }
+                /* the copied run is now in the output, so the checksum
+                   takes it in one block update instead of per byte */
+                checksum_output_run(s, match_first);
             }
             else
                 s->outcnt += len;
@@ -741,7 +962,24 @@ local int codes(struct state *s,
     leteral_symbol_total_bits +=
         get_symbol_length_from_huffman_table(lencode, 256);
 
-    print_compressed_data_hex(symbol, data_json);
+    print_compressed_data_hex(symbol, data_json, PRINT_DETAIL_SEQUENCES);
+
+    if (print_data_verbose && !scan_only) {
+        if (binary_sidecar_enable && binary_sidecar_file) {
+            if (compressed_data_log_file &&
+                print_detail_level >= PRINT_DETAIL_SEQUENCES)
+                sidecar_ref_to_json(json, "ENCODED_BIT_STREAM", sidecar_start, 2);
+            else if (decompressed_data_log_file &&
+                     print_detail_level >= PRINT_DETAIL_BYTES)
+                sidecar_ref_to_json(json, "DECOMPRESSED_DATA", sidecar_start, 1);
+        }
+        else if (json_stream_enable &&
+                 ((compressed_data_log_file &&
+                   print_detail_level >= PRINT_DETAIL_SEQUENCES) ||
+                  (decompressed_data_log_file &&
+                   print_detail_level >= PRINT_DETAIL_BYTES)))
+            jw_end_array();
+    }
 
     encoded_stream_total_bits = leteral_symbol_total_bits +
         length_symbol_total_bits +
@@ -807,32 +1045,221 @@ local int codes(struct state *s,
  *   length, this can be implemented as an incomplete code.  Then the invalid
  *   codes are detected while decoding.
  */
+/*
+ * Decoding tables for the fixed codes, exactly what construct() would build
+ * from the code lengths given in the format notes above but laid down at
+ * compile time, first-level fast tables included.  Fixed blocks therefore
+ * start decoding with no setup work at all, and fixed() no longer writes to
+ * shared static tables.
+ */
+local const short fixlencnt[16] = {
+    0, 0, 0, 0, 0, 0, 0, 24, 152, 112, 0, 0, 0, 0, 0, 0
+};
+
+local const short fixlensym[288] = {
+    256, 257, 258, 259, 260, 261, 262, 263, 264, 265, 266, 267,
+    268, 269, 270, 271, 272, 273, 274, 275, 276, 277, 278, 279,
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11,
+    12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23,
+    24, 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35,
+    36, 37, 38, 39, 40, 41, 42, 43, 44, 45, 46, 47,
+    48, 49, 50, 51, 52, 53, 54, 55, 56, 57, 58, 59,
+    60, 61, 62, 63, 64, 65, 66, 67, 68, 69, 70, 71,
+    72, 73, 74, 75, 76, 77, 78, 79, 80, 81, 82, 83,
+    84, 85, 86, 87, 88, 89, 90, 91, 92, 93, 94, 95,
+    96, 97, 98, 99, 100, 101, 102, 103, 104, 105, 106, 107,
+    108, 109, 110, 111, 112, 113, 114, 115, 116, 117, 118, 119,
+    120, 121, 122, 123, 124, 125, 126, 127, 128, 129, 130, 131,
+    132, 133, 134, 135, 136, 137, 138, 139, 140, 141, 142, 143,
+    280, 281, 282, 283, 284, 285, 286, 287, 144, 145, 146, 147,
+    148, 149, 150, 151, 152, 153, 154, 155, 156, 157, 158, 159,
+    160, 161, 162, 163, 164, 165, 166, 167, 168, 169, 170, 171,
+    172, 173, 174, 175, 176, 177, 178, 179, 180, 181, 182, 183,
+    184, 185, 186, 187, 188, 189, 190, 191, 192, 193, 194, 195,
+    196, 197, 198, 199, 200, 201, 202, 203, 204, 205, 206, 207,
+    208, 209, 210, 211, 212, 213, 214, 215, 216, 217, 218, 219,
+    220, 221, 222, 223, 224, 225, 226, 227, 228, 229, 230, 231,
+    232, 233, 234, 235, 236, 237, 238, 239, 240, 241, 242, 243,
+    244, 245, 246, 247, 248, 249, 250, 251, 252, 253, 254, 255
+};
+
+local const struct huffman fixlencode = {
+    (short *)fixlencnt, (short *)fixlensym, {
+    3840, 4176, 4112, 4376, 3856, 4208, 4144, 4800,
+    3848, 4192, 4128, 4768, 4096, 4224, 4160, 4832,
+    3844, 4184, 4120, 4752, 3860, 4216, 4152, 4816,
+    3852, 4200, 4136, 4784, 4104, 4232, 4168, 4848,
+    3842, 4180, 4116, 4380, 3858, 4212, 4148, 4808,
+    3850, 4196, 4132, 4776, 4100, 4228, 4164, 4840,
+    3846, 4188, 4124, 4760, 3862, 4220, 4156, 4824,
+    3854, 4204, 4140, 4792, 4108, 4236, 4172, 4856,
+    3841, 4178, 4114, 4378, 3857, 4210, 4146, 4804,
+    3849, 4194, 4130, 4772, 4098, 4226, 4162, 4836,
+    3845, 4186, 4122, 4756, 3861, 4218, 4154, 4820,
+    3853, 4202, 4138, 4788, 4106, 4234, 4170, 4852,
+    3843, 4182, 4118, 4382, 3859, 4214, 4150, 4812,
+    3851, 4198, 4134, 4780, 4102, 4230, 4166, 4844,
+    3847, 4190, 4126, 4764, 3863, 4222, 4158, 4828,
+    3855, 4206, 4142, 4796, 4110, 4238, 4174, 4860,
+    3840, 4177, 4113, 4377, 3856, 4209, 4145, 4802,
+    3848, 4193, 4129, 4770, 4097, 4225, 4161, 4834,
+    3844, 4185, 4121, 4754, 3860, 4217, 4153, 4818,
+    3852, 4201, 4137, 4786, 4105, 4233, 4169, 4850,
+    3842, 4181, 4117, 4381, 3858, 4213, 4149, 4810,
+    3850, 4197, 4133, 4778, 4101, 4229, 4165, 4842,
+    3846, 4189, 4125, 4762, 3862, 4221, 4157, 4826,
+    3854, 4205, 4141, 4794, 4109, 4237, 4173, 4858,
+    3841, 4179, 4115, 4379, 3857, 4211, 4147, 4806,
+    3849, 4195, 4131, 4774, 4099, 4227, 4163, 4838,
+    3845, 4187, 4123, 4758, 3861, 4219, 4155, 4822,
+    3853, 4203, 4139, 4790, 4107, 4235, 4171, 4854,
+    3843, 4183, 4119, 4383, 3859, 4215, 4151, 4814,
+    3851, 4199, 4135, 4782, 4103, 4231, 4167, 4846,
+    3847, 4191, 4127, 4766, 3863, 4223, 4159, 4830,
+    3855, 4207, 4143, 4798, 4111, 4239, 4175, 4862,
+    3840, 4176, 4112, 4376, 3856, 4208, 4144, 4801,
+    3848, 4192, 4128, 4769, 4096, 4224, 4160, 4833,
+    3844, 4184, 4120, 4753, 3860, 4216, 4152, 4817,
+    3852, 4200, 4136, 4785, 4104, 4232, 4168, 4849,
+    3842, 4180, 4116, 4380, 3858, 4212, 4148, 4809,
+    3850, 4196, 4132, 4777, 4100, 4228, 4164, 4841,
+    3846, 4188, 4124, 4761, 3862, 4220, 4156, 4825,
+    3854, 4204, 4140, 4793, 4108, 4236, 4172, 4857,
+    3841, 4178, 4114, 4378, 3857, 4210, 4146, 4805,
+    3849, 4194, 4130, 4773, 4098, 4226, 4162, 4837,
+    3845, 4186, 4122, 4757, 3861, 4218, 4154, 4821,
+    3853, 4202, 4138, 4789, 4106, 4234, 4170, 4853,
+    3843, 4182, 4118, 4382, 3859, 4214, 4150, 4813,
+    3851, 4198, 4134, 4781, 4102, 4230, 4166, 4845,
+    3847, 4190, 4126, 4765, 3863, 4222, 4158, 4829,
+    3855, 4206, 4142, 4797, 4110, 4238, 4174, 4861,
+    3840, 4177, 4113, 4377, 3856, 4209, 4145, 4803,
+    3848, 4193, 4129, 4771, 4097, 4225, 4161, 4835,
+    3844, 4185, 4121, 4755, 3860, 4217, 4153, 4819,
+    3852, 4201, 4137, 4787, 4105, 4233, 4169, 4851,
+    3842, 4181, 4117, 4381, 3858, 4213, 4149, 4811,
+    3850, 4197, 4133, 4779, 4101, 4229, 4165, 4843,
+    3846, 4189, 4125, 4763, 3862, 4221, 4157, 4827,
+    3854, 4205, 4141, 4795, 4109, 4237, 4173, 4859,
+    3841, 4179, 4115, 4379, 3857, 4211, 4147, 4807,
+    3849, 4195, 4131, 4775, 4099, 4227, 4163, 4839,
+    3845, 4187, 4123, 4759, 3861, 4219, 4155, 4823,
+    3853, 4203, 4139, 4791, 4107, 4235, 4171, 4855,
+    3843, 4183, 4119, 4383, 3859, 4215, 4151, 4815,
+    3851, 4199, 4135, 4783, 4103, 4231, 4167, 4847,
+    3847, 4191, 4127, 4767, 3863, 4223, 4159, 4831,
+    3855, 4207, 4143, 4799, 4111, 4239, 4175, 4863
+    }
+};
+
+local const short fixdistcnt[16] = {
+    0, 0, 0, 0, 0, 30, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+};
+
+local const short fixdistsym[30] = {
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11,
+    12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23,
+    24, 25, 26, 27, 28, 29
+};
+
+local const struct huffman fixdistcode = {
+    (short *)fixdistcnt, (short *)fixdistsym, {
+    2560, 2576, 2568, 2584, 2564, 2580, 2572, 2588,
+    2562, 2578, 2570, 2586, 2566, 2582, 2574, 0,
+    2561, 2577, 2569, 2585, 2565, 2581, 2573, 2589,
+    2563, 2579, 2571, 2587, 2567, 2583, 2575, 0,
+    2560, 2576, 2568, 2584, 2564, 2580, 2572, 2588,
+    2562, 2578, 2570, 2586, 2566, 2582, 2574, 0,
+    2561, 2577, 2569, 2585, 2565, 2581, 2573, 2589,
+    2563, 2579, 2571, 2587, 2567, 2583, 2575, 0,
+    2560, 2576, 2568, 2584, 2564, 2580, 2572, 2588,
+    2562, 2578, 2570, 2586, 2566, 2582, 2574, 0,
+    2561, 2577, 2569, 2585, 2565, 2581, 2573, 2589,
+    2563, 2579, 2571, 2587, 2567, 2583, 2575, 0,
+    2560, 2576, 2568, 2584, 2564, 2580, 2572, 2588,
+    2562, 2578, 2570, 2586, 2566, 2582, 2574, 0,
+    2561, 2577, 2569, 2585, 2565, 2581, 2573, 2589,
+    2563, 2579, 2571, 2587, 2567, 2583, 2575, 0,
+    2560, 2576, 2568, 2584, 2564, 2580, 2572, 2588,
+    2562, 2578, 2570, 2586, 2566, 2582, 2574, 0,
+    2561, 2577, 2569, 2585, 2565, 2581, 2573, 2589,
+    2563, 2579, 2571, 2587, 2567, 2583, 2575, 0,
+    2560, 2576, 2568, 2584, 2564, 2580, 2572, 2588,
+    2562, 2578, 2570, 2586, 2566, 2582, 2574, 0,
+    2561, 2577, 2569, 2585, 2565, 2581, 2573, 2589,
+    2563, 2579, 2571, 2587, 2567, 2583, 2575, 0,
+    2560, 2576, 2568, 2584, 2564, 2580, 2572, 2588,
+    2562, 2578, 2570, 2586, 2566, 2582, 2574, 0,
+    2561, 2577, 2569, 2585, 2565, 2581, 2573, 2589,
+    2563, 2579, 2571, 2587, 2567, 2583, 2575, 0,
+    2560, 2576, 2568, 2584, 2564, 2580, 2572, 2588,
+    2562, 2578, 2570, 2586, 2566, 2582, 2574, 0,
+    2561, 2577, 2569, 2585, 2565, 2581, 2573, 2589,
+    2563, 2579, 2571, 2587, 2567, 2583, 2575, 0,
+    2560, 2576, 2568, 2584, 2564, 2580, 2572, 2588,
+    2562, 2578, 2570, 2586, 2566, 2582, 2574, 0,
+    2561, 2577, 2569, 2585, 2565, 2581, 2573, 2589,
+    2563, 2579, 2571, 2587, 2567, 2583, 2575, 0,
+    2560, 2576, 2568, 2584, 2564, 2580, 2572, 2588,
+    2562, 2578, 2570, 2586, 2566, 2582, 2574, 0,
+    2561, 2577, 2569, 2585, 2565, 2581, 2573, 2589,
+    2563, 2579, 2571, 2587, 2567, 2583, 2575, 0,
+    2560, 2576, 2568, 2584, 2564, 2580, 2572, 2588,
+    2562, 2578, 2570, 2586, 2566, 2582, 2574, 0,
+    2561, 2577, 2569, 2585, 2565, 2581, 2573, 2589,
+    2563, 2579, 2571, 2587, 2567, 2583, 2575, 0,
+    2560, 2576, 2568, 2584, 2564, 2580, 2572, 2588,
+    2562, 2578, 2570, 2586, 2566, 2582, 2574, 0,
+    2561, 2577, 2569, 2585, 2565, 2581, 2573, 2589,
+    2563, 2579, 2571, 2587, 2567, 2583, 2575, 0,
+    2560, 2576, 2568, 2584, 2564, 2580, 2572, 2588,
+    2562, 2578, 2570, 2586, 2566, 2582, 2574, 0,
+    2561, 2577, 2569, 2585, 2565, 2581, 2573, 2589,
+    2563, 2579, 2571, 2587, 2567, 2583, 2575, 0,
+    2560, 2576, 2568, 2584, 2564, 2580, 2572, 2588,
+    2562, 2578, 2570, 2586, 2566, 2582, 2574, 0,
+    2561, 2577, 2569, 2585, 2565, 2581, 2573, 2589,
+    2563, 2579, 2571, 2587, 2567, 2583, 2575, 0,
+    2560, 2576, 2568, 2584, 2564, 2580, 2572, 2588,
+    2562, 2578, 2570, 2586, 2566, 2582, 2574, 0,
+    2561, 2577, 2569, 2585, 2565, 2581, 2573, 2589,
+    2563, 2579, 2571, 2587, 2567, 2583, 2575, 0,
+    2560, 2576, 2568, 2584, 2564, 2580, 2572, 2588,
+    2562, 2578, 2570, 2586, 2566, 2582, 2574, 0,
+    2561, 2577, 2569, 2585, 2565, 2581, 2573, 2589,
+    2563, 2579, 2571, 2587, 2567, 2583, 2575, 0
+    }
+};
+
+/* the scratch construct() runs in fixed() document the fixed codes in the
+   JSON once per top-level decode; puff() re-arms this latch so the output
+   does not depend on batch position or on earlier measuring pre-scans */
+local int fixed_virgin = 1;
+
 local int fixed(struct state *s, cJSON* json)
 {
-    static int virgin = 1;
-    static short lencnt[MAXBITS+1], lensym[FIXLCODES];
-    static short distcnt[MAXBITS+1], distsym[MAXDCODES];
-    static struct huffman lencode, distcode;
     int decompressed_bytes_size = s->outcnt;
     int bit_position_start = get_input_bit_position(s);
     int bit_position_end = get_input_bit_position(s);
     int ret = 0;
+    double stats_t0;
 
     cJSON* btype_json = cJSON_AddObjectToObject(json, "BTYPE");
     cJSON_AddNumberToObject(btype_json, "bit_size", 2);
     cJSON_AddNumberToObject(btype_json, "value", 1);
     cJSON_AddStringToObject(btype_json, "description", "compressed with fixed Huffman codes");
 
-    /* build fixed huffman tables if first call (may not be thread safe) */
-    if (virgin) {
+    /* the decode tables are prebuilt above; the first call still runs
+       construct() into scratch tables purely to document the fixed codes
+       in the JSON, exactly as it always has */
+    if (fixed_virgin) {
         int symbol;
         short lengths[FIXLCODES];
+        short scratchcnt[MAXBITS+1], scratchsym[FIXLCODES];
+        struct huffman scratch;
 
-        /* construct lencode and distcode */
-        lencode.count = lencnt;
-        lencode.symbol = lensym;
-        distcode.count = distcnt;
-        distcode.symbol = distsym;
+        scratch.count = scratchcnt;
+        scratch.symbol = scratchsym;
 
         /* literal/length table */
         for (symbol = 0; symbol < 144; symbol++)
@@ -848,7 +1275,7 @@ local int fixed(struct state *s, cJSON* json)
         if (compressed_data_log_file) {
             extracted_literal_length_huffman_table_json = cJSON_AddObjectToObject(json, "cJSON* extracted_literal_length_huffman_table");
         }
-        construct(&lencode, lengths, FIXLCODES, extracted_literal_length_huffman_table_json);
+        construct(&scratch, lengths, FIXLCODES, extracted_literal_length_huffman_table_json);
         /* distance table */
         for (symbol = 0; symbol < MAXDCODES; symbol++)
             lengths[symbol] = 5;
@@ -857,13 +1284,16 @@ local int fixed(struct state *s, cJSON* json)
         if (compressed_data_log_file) {
             extracted_distance_huffman_table_json = cJSON_AddObjectToObject(json, "extracted_distance_huffman_table");
         }
-        construct(&distcode, lengths, MAXDCODES, extracted_distance_huffman_table_json);
-        /* do this just once */
-        virgin = 0;
+        construct(&scratch, lengths, MAXDCODES, extracted_distance_huffman_table_json);
+        /* do this just once per decode */
+        fixed_virgin = 0;
     }
 
     /* decode data until end-of-block code */
-    ret = codes(s, &lencode, &distcode, json);
+    stats_t0 = stats_enable ? stats_now() : 0;
+    ret = codes(s, &fixlencode, &fixdistcode, json);
+    if (stats_enable)
+        stats_symbol_exec_time += stats_now() - stats_t0;
     bit_position_end = get_input_bit_position(s);
     decompressed_bytes_size = s->outcnt - decompressed_bytes_size;
     if (decompressed_data_log_file) {
@@ -976,6 +1406,7 @@ local int dynamic(struct state *s, cJSON* json)
     int bit_position_start = get_input_bit_position(s);
     int bit_position_end = get_input_bit_position(s);
     int ret = 0;
+    double stats_t0;
 
     /* construct lencode and distcode */
     lencode.count = lencnt;
@@ -1015,14 +1446,16 @@ local int dynamic(struct state *s, cJSON* json)
     addStringToObjectFormatted(hclen_json, "description", "%d (%d + 4) of Code Length codes stored in CODE_LENGTH_TABLE", ncode, ncode - 4);
 
     cJSON* code_length_table_json = NULL;
-    if (print_data_verbose && compressed_data_log_file) {
+    if (print_data_verbose && print_detail_level >= PRINT_DETAIL_TABLES &&
+        compressed_data_log_file) {
         code_length_table_json = cJSON_AddArrayToObject(json, "CODE_LENGTH_TABLE");
     }
 
     /* read code length code lengths (really), missing lengths are zero */
     for (index = 0; index < ncode; index++) {
         lengths[order[index]] = bits(s, 3);
-        if (print_data_verbose && compressed_data_log_file) {
+        if (print_data_verbose && print_detail_level >= PRINT_DETAIL_TABLES &&
+            compressed_data_log_file) {
             cJSON* item_json = cJSON_CreateObject();
             cJSON_AddNumberToObject(item_json, "index", index);
             cJSON_AddNumberToObject(item_json, "length", order[index]);
@@ -1040,7 +1473,8 @@ local int dynamic(struct state *s, cJSON* json)
     }
     for (; index < 19; index++) {
         lengths[order[index]] = 0;
-        if (print_data_verbose && compressed_data_log_file) {
+        if (print_data_verbose && print_detail_level >= PRINT_DETAIL_TABLES &&
+            compressed_data_log_file) {
             cJSON* item_json = cJSON_CreateObject();
             cJSON_AddNumberToObject(item_json, "index", index);
             cJSON_AddNumberToObject(item_json, "length", order[index]);
@@ -1068,7 +1502,8 @@ local int dynamic(struct state *s, cJSON* json)
     }
 
     cJSON* literal_length_distance_table_json = NULL;
-    if (print_data_verbose && compressed_data_log_file) {
+    if (print_data_verbose && print_detail_level >= PRINT_DETAIL_TABLES &&
+        compressed_data_log_file) {
         literal_length_distance_table_json = cJSON_AddArrayToObject(json, "LITERAL_LENGTH_DISTANCE_TABLE");
     }
     bit_position_start = get_input_bit_position(s);
@@ -1079,11 +1514,11 @@ local int dynamic(struct state *s, cJSON* json)
         int symbol;             /* decoded value */
         int repeat_times;
         int len;                /* last length to repeat */
-        if (print_data_verbose) {
+        if (print_data_verbose && print_detail_level >= PRINT_DETAIL_TABLES) {
             symbol_size = get_input_bit_position(s);
         }
         symbol = decode(s, &lencode);
-        if (print_data_verbose) {
+        if (print_data_verbose && print_detail_level >= PRINT_DETAIL_TABLES) {
             symbol_size = get_input_bit_position(s) - symbol_size;
             symbol_value = get_encoded_val_from_huffman_table(&lencode, symbol);
         }
@@ -1091,7 +1526,8 @@ local int dynamic(struct state *s, cJSON* json)
             return symbol;          /* invalid symbol */
 
         cJSON* item_json = NULL;
-        if (print_data_verbose && compressed_data_log_file) {
+        if (print_data_verbose && print_detail_level >= PRINT_DETAIL_TABLES &&
+            compressed_data_log_file) {
             // TODO add to array
             item_json = cJSON_CreateObject();
             cJSON_AddNumberToObject(item_json, "symbol", index);
@@ -1101,7 +1537,8 @@ local int dynamic(struct state *s, cJSON* json)
         }
 
         if (symbol < 16) {               /* length in 0..15 */
-            if (print_data_verbose && compressed_data_log_file) {
+            if (print_data_verbose && print_detail_level >= PRINT_DETAIL_TABLES &&
+                compressed_data_log_file) {
                 if (index < nlen)
                     addStringToObjectFormatted(item_json, "description", "literal_length symbol %d encoded to %d bits", index, symbol);
                 else {
@@ -1120,7 +1557,8 @@ local int dynamic(struct state *s, cJSON* json)
                 }
                 len = lengths[index - 1];       /* last length */
                 repeat_times = 3 + bits(s, 2);
-                if (print_data_verbose && compressed_data_log_file) {
+                if (print_data_verbose && print_detail_level >= PRINT_DETAIL_TABLES &&
+                    compressed_data_log_file) {
                     cJSON* extra_json = cJSON_AddObjectToObject(item_json, "extra");
                     cJSON_AddNumberToObject(extra_json, "bit_size", 2);
                     cJSON_AddNumberToObject(extra_json, "value", repeat_times - 3);
@@ -1137,7 +1575,8 @@ local int dynamic(struct state *s, cJSON* json)
             }
             else if (symbol == 17){      /* repeat zero 3..10 times */
                 repeat_times = 3 + bits(s, 3);
-                if (print_data_verbose && compressed_data_log_file) {
+                if (print_data_verbose && print_detail_level >= PRINT_DETAIL_TABLES &&
+                    compressed_data_log_file) {
                     cJSON* extra_json = cJSON_AddObjectToObject(item_json, "extra");
                     cJSON_AddNumberToObject(extra_json, "bit_size", 3);
                     cJSON_AddNumberToObject(extra_json, "value", repeat_times - 3);
@@ -1154,7 +1593,8 @@ local int dynamic(struct state *s, cJSON* json)
             }
             else {                       /* == 18, repeat zero 11..138 times */
                 repeat_times = 11 + bits(s, 7);
-                if (print_data_verbose && compressed_data_log_file) {
+                if (print_data_verbose && print_detail_level >= PRINT_DETAIL_TABLES &&
+                    compressed_data_log_file) {
                     cJSON* extra_json = cJSON_AddObjectToObject(item_json, "extra");
                     cJSON_AddNumberToObject(extra_json, "bit_size", 7);
                     cJSON_AddNumberToObject(extra_json, "value", repeat_times - 11);
@@ -1178,7 +1618,8 @@ local int dynamic(struct state *s, cJSON* json)
                 lengths[index++] = len;
         }
 
-        if (print_data_verbose && compressed_data_log_file) {
+        if (print_data_verbose && print_detail_level >= PRINT_DETAIL_TABLES &&
+            compressed_data_log_file) {
             cJSON_AddItemToArray(literal_length_distance_table_json, item_json);
         }
     }
@@ -1219,7 +1660,10 @@ local int dynamic(struct state *s, cJSON* json)
     bit_position_start = get_input_bit_position(s);
 
     /* decode data until end-of-block code */
+    stats_t0 = stats_enable ? stats_now() : 0;
     ret = codes(s, &lencode, &distcode, json);
+    if (stats_enable)
+        stats_symbol_exec_time += stats_now() - stats_t0;
 
     bit_position_end = get_input_bit_position(s);
     decompressed_bytes_size = s->outcnt - decompressed_bytes_size;
@@ -1287,10 +1731,22 @@ int puff(unsigned char *dest,           /* pointer to destination pointer */
     unsigned block_start_bit_position = 0;
     unsigned block_end_bit_position = 0;
     unsigned block_bit_size = 0;
+    static unsigned char window[WINSIZE];   /* streaming mode output window */
+
     /* initialize output state */
     s.out = dest;
     s.outlen = *destlen;                /* ignored if dest is NIL */
     s.outcnt = 0;
+    s.window = NIL;
+    s.outfile = NULL;
+    if (stream_window_enable && decompressed_data_file != NULL) {
+        /* stream through the sliding window into the decompressed data
+           file instead of requiring the whole output buffer up front */
+        s.window = window;
+        s.outfile = decompressed_data_file;
+        s.out = window;                 /* take the write paths */
+        s.outlen = (unsigned long)-1;
+    }
 
     /* initialize input state */
     s.in = source;
@@ -1298,6 +1754,8 @@ int puff(unsigned char *dest,           /* pointer to destination pointer */
     s.incnt = 0;
     s.bitbuf = 0;
     s.bitcnt = 0;
+    s.block_json = NULL;
+    fixed_virgin = 1;
 
     cJSON* blocks_json = cJSON_AddArrayToObject(json, "DEFLATE_BLOCK");
 
@@ -1305,13 +1763,27 @@ int puff(unsigned char *dest,           /* pointer to destination pointer */
     if (setjmp(s.env) != 0) {             /* if came back here via longjmp() */
         err = 2;                        /* then skip do-loop, return error */
         fprintf(stderr, "try to read past available input!\n");
+        /* truncated capture: keep the partially decoded block, so the
+           structure decoded so far survives instead of being thrown away */
+        if (tolerant_enable && s.block_json != NULL)
+            cJSON_AddItemToArray(blocks_json, s.block_json);
     } else {
         /* process blocks until last block or error */
         do {
+            /* --range: every block from here on starts past the window,
+               so there is nothing left to report */
+            if (range_enable &&
+                (unsigned long)(block_start_bit_position >> 3) >=
+                    range_offset + range_len) {
+                err = 0;
+                break;
+            }
+
             last = bits(&s, 1);         /* one if last block */
             block_index++;
 
             cJSON* block_json = cJSON_CreateObject();
+            s.block_json = block_json;
             cJSON_AddNumberToObject(block_json, "BLOCK_BIT_POSITION", block_start_bit_position);
             
             cJSON* bfinal_json = cJSON_AddObjectToObject(block_json, "BFINAL");
@@ -1324,6 +1796,28 @@ int puff(unsigned char *dest,           /* pointer to destination pointer */
             }
 
             type = bits(&s, 2);         /* block type 0..3 */
+
+            /* --index: record where this block starts in the input and
+               where its output resumes, before any of it is decoded */
+            if (block_index_json != NULL) {
+                unsigned long out_pos = get_output_byte_position(&s);
+                cJSON* index_entry_json = cJSON_CreateObject();
+                cJSON_AddNumberToObject(index_entry_json, "block", block_index - 1);
+                cJSON_AddNumberToObject(index_entry_json, "type", type);
+                cJSON_AddNumberToObject(index_entry_json, "last", last);
+                cJSON_AddNumberToObject(index_entry_json, "in_bit_offset", block_start_bit_position);
+                cJSON_AddNumberToObject(index_entry_json, "out_byte_offset", out_pos);
+                /* entries carry no window snapshot, so record how much
+                   output history a restart here would have to rebuild: a
+                   compressed block can reference up to 32K of earlier
+                   output, a stored block copies input and needs none */
+                cJSON_AddNumberToObject(index_entry_json, "window_from",
+                                        type == 0 ? out_pos :
+                                        out_pos < WINSIZE ? 0 :
+                                        out_pos - WINSIZE);
+                cJSON_AddItemToArray(block_index_json, index_entry_json);
+            }
+
             if (type == 0) {
                 err = stored(&s, block_json);
             } else if (type == 1) {
@@ -1346,25 +1840,55 @@ int puff(unsigned char *dest,           /* pointer to destination pointer */
 
             cJSON_AddNumberToObject(block_json, "BLOCK_BIT_SIZE", block_bit_size);
 
+            /* --range: blocks before the window still have to be decoded
+               for the output history, but only intersecting ones are kept */
+            int block_in_range = !range_enable ||
+                ((unsigned long)(block_start_bit_position >> 3) <
+                     range_offset + range_len &&
+                 (unsigned long)((block_end_bit_position + 7) >> 3) >
+                     range_offset);
+
             block_start_bit_position = get_input_bit_position(&s);
             if (block_start_bit_position == (*sourcelen << 3)) {
                 err = 0;
                 break;
             }
 
-            cJSON_AddItemToArray(blocks_json, block_json);
+            if (block_in_range)
+                cJSON_AddItemToArray(blocks_json, block_json);
+            s.block_json = NULL;
 
             if (err != 0)
                 break;                  /* return with error */
         } while (!last);
     }
 
+    /* --tolerant: close out the JSON instead of failing, whether the input
+       ran out via the longjmp above, a stored block was cut short (2) or a
+       block decoder rejected the structure (negative); the partial
+       structure above is kept and recorded as such */
+    if (tolerant_enable && (err == 2 || err < 0)) {
+        cJSON* truncated_json = cJSON_AddObjectToObject(json, "TRUNCATED");
+        cJSON_AddNumberToObject(truncated_json, "bit_position", get_input_bit_position(&s));
+        cJSON_AddNumberToObject(truncated_json, "block", block_index - 1);
+        cJSON_AddStringToObject(truncated_json, "description",
+                                err == 2 ?
+                                "input exhausted mid-block; structure above is partial" :
+                                "malformed block structure; structure above is partial");
+        err = 0;
+    }
+
     if (err == 0) {
         cJSON* block_summary_json = cJSON_AddObjectToObject(json, "BLOCK_SUMMARY");
         cJSON_AddNumberToObject(block_summary_json, "block_num", block_index);
         cJSON_AddNumberToObject(block_summary_json, "decompressed_bytes", s.outcnt);
     }
 
+    /* flush whatever is left in the window; earlier flushes happen exactly
+       at window boundaries so the remainder starts at the window base */
+    if (err == 0 && s.window != NIL)
+        fwrite(s.window, 1, s.outcnt & (WINSIZE - 1), s.outfile);
+
     /* update the lengths and return */
     if (err <= 0) {
         *destlen = s.outcnt;
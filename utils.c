@@ -1,5 +1,15 @@
 #include "utils.h"
 
+#if defined(_WIN32) || defined(WIN32)
+#  include <windows.h>
+#else
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <fcntl.h>
+#  include <unistd.h>
+#endif
+#include <time.h>
+
 FILE *compressed_data_log_file = NULL;
 FILE *decompressed_data_log_file = NULL;
 FILE *decompressed_data_file = NULL;
@@ -7,7 +17,40 @@ FILE *decompressed_data_file = NULL;
 cJSON *compressed_data_json = NULL;
 cJSON *decompressed_data_json = NULL;
 
+FILE *json_stream_file = NULL;
+unsigned char json_stream_enable = 0;
+unsigned char scan_only = 0;
+unsigned char stream_window_enable = 0;
+
+FILE *binary_sidecar_file = NULL;
+unsigned char binary_sidecar_enable = 0;
+unsigned long binary_sidecar_offset = 0;
+
+/* --index: array collecting one compact entry per container block so a
+   later run can seek to block N without re-decoding everything before it */
+cJSON *block_index_json = NULL;
+unsigned char block_index_enable = 0;
+
+/* --range OFFSET:LEN: restrict JSON emission to structures that intersect
+   this window of input bytes and stop decoding once past it */
+unsigned long range_offset = 0;
+unsigned long range_len = 0;
+unsigned char range_enable = 0;
+
+/* --tolerant: truncated or malformed input closes out the JSON with the
+   structure decoded so far and an error record instead of aborting */
+unsigned char tolerant_enable = 0;
+
+/* nonzero once json_arena_init() has installed the slab allocator */
+static int json_arena_active = 0;
+
+#define JW_MAX_DEPTH 64
+
+static int jw_depth = 0;
+static unsigned int jw_item_count[JW_MAX_DEPTH] = {0};
+
 unsigned char print_data_verbose = 0;
+unsigned char print_detail_level = PRINT_DETAIL_BYTES;
 
 unsigned int compressed_data_print_num_count = 0;
 unsigned int decompressed_data_print_num_count = 0;
@@ -19,6 +62,8 @@ unsigned char compressed_data_print_buffer[200] = {0};
 unsigned char decompressed_data_print_buffer[200] = {0};
 
 unsigned int adler32_checksum = 1;
+unsigned int crc32_checksum = 0xFFFFFFFFU;
+unsigned char crc32_enable = 0;
 
 char *print_level_tabel[] = {"",
                        "\t",
@@ -34,6 +79,79 @@ char *print_level_tabel[] = {"",
                        "\t\t\t\t\t\t\t\t\t\t\t",
                        };
 
+/* Map the input file *name read-only so the decoders parse straight out of
+   the page cache with no copies and no realloc churn.  Returns the mapped
+   address and sets *len to the file size, or returns NULL if the file can
+   not be mapped (caller falls back to the fread path).  A NULL name means
+   stdin, which can never be mapped. */
+#if defined(_WIN32) || defined(WIN32)
+void *map_file(const char *name, size_t *len)
+{
+    HANDLE file, mapping;
+    LARGE_INTEGER size;
+    void *addr;
+
+    *len = 0;
+    if (name == NULL)
+        return NULL;
+    file = CreateFileA(name, GENERIC_READ, FILE_SHARE_READ, NULL,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return NULL;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+        CloseHandle(file);
+        return NULL;
+    }
+    mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+    if (mapping == NULL)
+        return NULL;
+    addr = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (addr == NULL)
+        return NULL;
+    *len = (size_t)size.QuadPart;
+    return addr;
+}
+
+void unmap_file(void *addr, size_t len)
+{
+    (void)len;
+    if (addr)
+        UnmapViewOfFile(addr);
+}
+#else
+void *map_file(const char *name, size_t *len)
+{
+    int fd;
+    struct stat st;
+    void *addr;
+
+    *len = 0;
+    if (name == NULL)
+        return NULL;
+    fd = open(name, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+    if (fstat(fd, &st) < 0 || st.st_size == 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return NULL;
+    }
+    addr = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED)
+        return NULL;
+    *len = (size_t)st.st_size;
+    return addr;
+}
+
+void unmap_file(void *addr, size_t len)
+{
+    if (addr)
+        munmap(addr, len);
+}
+#endif
+
 unsigned int swap_uint32(unsigned int val)
 {
     val = ((val << 8) & 0xFF00FF00 ) | ((val >> 8) & 0xFF00FF);
@@ -60,9 +178,36 @@ void print_to_decompressed_log(char *fmt, ...)
     }
 }
 
-void print_compressed_data_hex(int data_val, cJSON* json)
+/* Record an {offset, length, element_size} reference into the binary
+   sidecar file in place of an inline JSON number array */
+void sidecar_ref_to_json(cJSON* json, const char *const name,
+                         unsigned long start_offset, int element_size)
 {
-    if (print_data_verbose && compressed_data_log_file) {
+    cJSON* ref_json = cJSON_AddObjectToObject(json, name);
+    cJSON_AddNumberToObject(ref_json, "offset", start_offset);
+    cJSON_AddNumberToObject(ref_json, "length", binary_sidecar_offset - start_offset);
+    cJSON_AddNumberToObject(ref_json, "element_size", element_size);
+}
+
+void print_compressed_data_hex(int data_val, cJSON* json, int min_level)
+{
+    if (scan_only)
+        return;
+    if (print_data_verbose && print_detail_level >= min_level &&
+        compressed_data_log_file) {
+        if (binary_sidecar_enable && binary_sidecar_file) {
+            /* symbols can exceed a byte, store them 16-bit little endian */
+            fputc(data_val & 0xFF, binary_sidecar_file);
+            fputc((data_val >> 8) & 0xFF, binary_sidecar_file);
+            binary_sidecar_offset += 2;
+            return;
+        }
+        if (json_stream_enable) {
+            jw_add_array_number(data_val);
+            return;
+        }
+        if (json == NULL)
+            return;
         cJSON* item = cJSON_CreateNumber(data_val);
         cJSON_AddItemToArray(json, item);
     }
@@ -86,9 +231,23 @@ void print_compressed_data_dec(int data_val, int print_level)
     }
 }
 
-void print_decompressed_data_hex(int data_val, cJSON* json)
+void print_decompressed_data_hex(int data_val, cJSON* json, int min_level)
 {
-    if (print_data_verbose && decompressed_data_file) {
+    if (scan_only)
+        return;
+    if (print_data_verbose && print_detail_level >= min_level &&
+        decompressed_data_file) {
+        if (binary_sidecar_enable && binary_sidecar_file) {
+            fputc(data_val & 0xFF, binary_sidecar_file);
+            binary_sidecar_offset++;
+            return;
+        }
+        if (json_stream_enable) {
+            jw_add_array_number(data_val);
+            return;
+        }
+        if (json == NULL)
+            return;
         cJSON* item = cJSON_CreateNumber(data_val);
         cJSON_AddItemToArray(json, item);
     }
@@ -120,24 +279,226 @@ void addStringToObjectFormatted(cJSON* json, const char *const name, const char
     cJSON_AddStringToObject(json, name, buffer);
 }
 
-void dump_data_to_number_array_json(cJSON* json, const char *const name, unsigned char *buffer, unsigned int num)
+/* The jw_* functions write JSON directly to json_stream_file as decoding
+   progresses, so peak memory stays proportional to the nesting depth
+   instead of the cJSON node count.  The call surface mirrors the cJSON
+   add-calls used everywhere else so decoders can switch per call site.
+   A NULL name writes an anonymous value or scope, for array elements. */
+static void jw_write_indent(void)
 {
-    unsigned char print_buffer[200] = {0};
-    unsigned int print_count = 0;
-    unsigned int lines, remain, i, j;
-    unsigned char data_val;
+    int level = jw_depth;
 
-    lines = num >> 4;
-    remain = num & 0xF;
+    if (level > 11)
+        level = 11;
+    fprintf(json_stream_file, "%s", print_level_tabel[level]);
+}
 
-    cJSON *array = cJSON_AddArrayToObject(json, name);
+static void jw_write_separator(void)
+{
+    if (jw_item_count[jw_depth])
+        fprintf(json_stream_file, ",\n");
+    else
+        fprintf(json_stream_file, "\n");
+    jw_item_count[jw_depth]++;
+    jw_write_indent();
+}
+
+static void jw_write_string_escaped(const char *const value)
+{
+    const char *p;
 
+    fputc('"', json_stream_file);
+    for (p = value; *p; p++) {
+        if (*p == '"' || *p == '\\')
+            fputc('\\', json_stream_file);
+        fputc(*p, json_stream_file);
+    }
+    fputc('"', json_stream_file);
+}
+
+void jw_begin_document(FILE *file)
+{
+    json_stream_file = file;
+    output_buffer_attach(file);
+    jw_depth = 0;
+    memset(jw_item_count, 0, sizeof(jw_item_count));
+    if (json_stream_file)
+        fprintf(json_stream_file, "{");
+}
+
+void jw_end_document(void)
+{
+    if (!json_stream_file)
+        return;
+
+    /* close any scopes a decoder left open on an error path */
+    while (jw_depth > 0) {
+        jw_depth--;
+        fprintf(json_stream_file, "\n");
+        jw_write_indent();
+        fprintf(json_stream_file, "]");
+    }
+    fprintf(json_stream_file, "\n}\n");
+    json_stream_file = NULL;
+}
+
+void jw_begin_object(const char *const name)
+{
+    if (!json_stream_file || jw_depth + 1 >= JW_MAX_DEPTH)
+        return;
+
+    jw_write_separator();
+    if (name != NULL) {
+        jw_write_string_escaped(name);
+        fprintf(json_stream_file, ":\t");
+    }
+    fprintf(json_stream_file, "{");
+    jw_depth++;
+    jw_item_count[jw_depth] = 0;
+}
+
+void jw_end_object(void)
+{
+    if (!json_stream_file || jw_depth == 0)
+        return;
+
+    jw_depth--;
+    fprintf(json_stream_file, "\n");
+    jw_write_indent();
+    fprintf(json_stream_file, "}");
+}
+
+void jw_begin_array(const char *const name)
+{
+    if (!json_stream_file || jw_depth + 1 >= JW_MAX_DEPTH)
+        return;
+
+    jw_write_separator();
+    if (name != NULL) {
+        jw_write_string_escaped(name);
+        fprintf(json_stream_file, ":\t");
+    }
+    fprintf(json_stream_file, "[");
+    jw_depth++;
+    jw_item_count[jw_depth] = 0;
+}
+
+void jw_end_array(void)
+{
+    if (!json_stream_file || jw_depth == 0)
+        return;
+
+    jw_depth--;
+    fprintf(json_stream_file, "\n");
+    jw_write_indent();
+    fprintf(json_stream_file, "]");
+}
+
+void jw_add_number(const char *const name, double value)
+{
+    if (!json_stream_file)
+        return;
+
+    jw_write_separator();
+    if (name != NULL) {
+        jw_write_string_escaped(name);
+        fprintf(json_stream_file, ":\t");
+    }
+    if (value == (double)(long)value)
+        fprintf(json_stream_file, "%ld", (long)value);
+    else
+        fprintf(json_stream_file, "%g", value);
+}
+
+void jw_add_string(const char *const name, const char *const value)
+{
+    if (!json_stream_file)
+        return;
+
+    jw_write_separator();
+    if (name != NULL) {
+        jw_write_string_escaped(name);
+        fprintf(json_stream_file, ":\t");
+    }
+    jw_write_string_escaped(value);
+}
+
+void jw_add_string_formatted(const char *const name, const char *const format, ...)
+{
+    char buffer[256];
+    va_list args;
+
+    va_start(args, format);
+    vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    jw_add_string(name, buffer);
+}
+
+void jw_add_array_number(double value)
+{
+    if (!json_stream_file)
+        return;
+
+    jw_write_separator();
+    if (value == (double)(long)value)
+        fprintf(json_stream_file, "%ld", (long)value);
+    else
+        fprintf(json_stream_file, "%g", value);
+}
+
+/* Append num byte values to an array in one pass: all nodes come from a
+   single allocation and are linked directly, instead of one allocation and
+   one cJSON_AddItemToArray tail walk per value.  cJSON_Delete would free
+   such nodes individually, so the bulk path is only taken while the arena
+   allocator (whose per-node free is a no-op) is installed. */
+void add_number_array_bulk(cJSON* array, const unsigned char *buffer,
+                           unsigned int num)
+{
+    cJSON *nodes, *first, *last;
+    unsigned int i;
+
+    if (array == NULL || num == 0)
+        return;
+
+    if (!json_arena_active) {
+        for (i = 0; i < num; i++)
+            cJSON_AddItemToArray(array, cJSON_CreateNumber(buffer[i]));
+        return;
+    }
+
+    nodes = cJSON_malloc(num * sizeof(cJSON));
+    if (nodes == NULL)
+        return;
+    memset(nodes, 0, num * sizeof(cJSON));
     for (i = 0; i < num; i++) {
-        data_val = *(buffer + i);
-        cJSON* item = cJSON_CreateNumber(data_val);
-        cJSON_AddItemToArray(array, item);
+        nodes[i].type = cJSON_Number;
+        nodes[i].valueint = buffer[i];
+        nodes[i].valuedouble = buffer[i];
+        if (i + 1 < num)
+            nodes[i].next = &nodes[i + 1];
+        if (i > 0)
+            nodes[i].prev = &nodes[i - 1];
+    }
+
+    /* splice the chain in; cJSON keeps the list tail in child->prev */
+    first = &nodes[0];
+    last = &nodes[num - 1];
+    if (array->child == NULL) {
+        array->child = first;
+        first->prev = last;
+    } else {
+        cJSON *tail = array->child->prev;
+        tail->next = first;
+        first->prev = tail;
+        array->child->prev = last;
     }
+}
+
+void dump_data_to_number_array_json(cJSON* json, const char *const name, unsigned char *buffer, unsigned int num)
+{
+    cJSON *array = cJSON_AddArrayToObject(json, name);
 
+    add_number_array_bulk(array, buffer, num);
 }
 
 void dump_data_to_string_json(cJSON* json, const char *const name, unsigned char *buffer, unsigned int num)
@@ -177,6 +538,43 @@ void dump_data_to_string_json(cJSON* json, const char *const name, unsigned char
 
 void dump_data_to_json(cJSON* json, const char *const name, unsigned char *buffer, unsigned int num)
 {
+    unsigned int i;
+
+    /* in scan mode only the size of bulk data is of interest, not its
+       content; headers and other small fields are still dumped in full */
+    if (scan_only && num > 16) {
+        cJSON_AddNumberToObject(json, "byte_size", num);
+        return;
+    }
+
+    /* below the full-bytes detail tier bulk data keeps only its size, the
+       same shape scan mode produces */
+    if (print_data_verbose && print_detail_level < PRINT_DETAIL_BYTES &&
+        num > 16) {
+        cJSON_AddNumberToObject(json, "byte_size", num);
+        return;
+    }
+
+    /* bulk data goes to the compact binary sidecar file, the JSON keeps an
+       {offset, length} reference into it instead of one number per byte */
+    if (binary_sidecar_enable && binary_sidecar_file && num > 16) {
+        unsigned long start = binary_sidecar_offset;
+        fwrite(buffer, 1, num, binary_sidecar_file);
+        binary_sidecar_offset += num;
+        sidecar_ref_to_json(json, name, start, 1);
+        return;
+    }
+
+    /* bulk arrays go straight to the stream file; small fields (checksums,
+       magic numbers) stay in the tree where downstream consumers expect them */
+    if (json_stream_enable && json_stream_file && num > 16) {
+        jw_begin_array(name);
+        for (i = 0; i < num; i++)
+            jw_add_array_number(*(buffer + i));
+        jw_end_array();
+        return;
+    }
+
     dump_data_to_number_array_json(json, name, buffer, num);
 }
 
@@ -210,22 +608,467 @@ void print_hex_with_buffer(unsigned char *buffer, unsigned int num, int print_le
     print_log_to_both("%s\"%s\"\n", print_level_tabel[print_level], print_buffer);
 }
 
-void adler32(unsigned char data_val)
+/* Block checksum engines.  The old adler32() did two conditional
+   subtractions per byte and was called once per decoded byte; these
+   update whole runs instead.  Adler-32 defers the modulo to once every
+   NMAX bytes (the largest run that cannot overflow 32 bits) with the
+   byte loop unrolled by eight; CRC-32 uses the slice-by-8 table method,
+   reading eight bytes per step through eight precomputed tables. */
+
+#define ADLER32_NMAX 5552
+
+void adler32_update(const unsigned char *buffer, unsigned int num)
 {
-    unsigned int upper_word, lower_word;
-    unsigned int base = 65521U;
+    unsigned int lower_word = adler32_checksum & 0xffff;
+    unsigned int upper_word = (adler32_checksum >> 16) & 0xffff;
+    unsigned int n;
 
-    upper_word = (adler32_checksum >> 16) & 0xffff;
-    lower_word = adler32_checksum & 0xffff;
+    while (num) {
+        n = num > ADLER32_NMAX ? ADLER32_NMAX : num;
+        num -= n;
+        while (n >= 8) {
+            lower_word += buffer[0]; upper_word += lower_word;
+            lower_word += buffer[1]; upper_word += lower_word;
+            lower_word += buffer[2]; upper_word += lower_word;
+            lower_word += buffer[3]; upper_word += lower_word;
+            lower_word += buffer[4]; upper_word += lower_word;
+            lower_word += buffer[5]; upper_word += lower_word;
+            lower_word += buffer[6]; upper_word += lower_word;
+            lower_word += buffer[7]; upper_word += lower_word;
+            buffer += 8;
+            n -= 8;
+        }
+        while (n--) {
+            lower_word += *buffer++;
+            upper_word += lower_word;
+        }
+        lower_word %= 65521U;
+        upper_word %= 65521U;
+    }
 
-    lower_word += data_val;
-    if (lower_word >= base)
-        lower_word -= base;
+    adler32_checksum = lower_word | (upper_word << 16);
+}
 
-    upper_word += lower_word;
+static unsigned int crc32_table[8][256];
+static int crc32_table_built = 0;
 
-    if (upper_word >= base)
-        upper_word -= base;
+static void crc32_build_table(void)
+{
+    unsigned int crc;
+    int i, j;
 
-    adler32_checksum = lower_word | (upper_word << 16);
+    for (i = 0; i < 256; i++) {
+        crc = i;
+        for (j = 0; j < 8; j++)
+            crc = (crc >> 1) ^ (0xEDB88320U & (0 - (crc & 1)));
+        crc32_table[0][i] = crc;
+    }
+    for (i = 0; i < 256; i++)
+        for (j = 1; j < 8; j++)
+            crc32_table[j][i] = (crc32_table[j - 1][i] >> 8) ^
+                crc32_table[0][crc32_table[j - 1][i] & 0xff];
+    crc32_table_built = 1;
+}
+
+void crc32_update(const unsigned char *buffer, unsigned int num)
+{
+    unsigned int crc = crc32_checksum;
+
+    if (!crc32_table_built)
+        crc32_build_table();
+
+    while (num >= 8) {
+        crc ^= buffer[0] | (buffer[1] << 8) | (buffer[2] << 16) |
+            ((unsigned int)buffer[3] << 24);
+        crc = crc32_table[7][crc & 0xff] ^
+              crc32_table[6][(crc >> 8) & 0xff] ^
+              crc32_table[5][(crc >> 16) & 0xff] ^
+              crc32_table[4][crc >> 24] ^
+              crc32_table[3][buffer[4]] ^
+              crc32_table[2][buffer[5]] ^
+              crc32_table[1][buffer[6]] ^
+              crc32_table[0][buffer[7]];
+        buffer += 8;
+        num -= 8;
+    }
+    while (num--)
+        crc = (crc >> 8) ^ crc32_table[0][(crc ^ *buffer++) & 0xff];
+
+    crc32_checksum = crc;
+}
+
+/* puff feeds every decoded run through here; zlib only needs the Adler
+   sum, gzip turns the CRC on as well */
+void checksum_update(const unsigned char *buffer, unsigned int num)
+{
+    adler32_update(buffer, num);
+    if (crc32_enable)
+        crc32_update(buffer, num);
+}
+
+/* Slab arena feeding cJSON_InitHooks.  A verbose dump allocates millions of
+   small nodes and strings; bump-allocating them from large slabs and freeing
+   the slab list at once avoids a malloc/free per node and cJSON_Delete's
+   recursive teardown. */
+#define JSON_ARENA_SLAB_SIZE (4 * 1024 * 1024)
+
+typedef struct json_arena_slab {
+    struct json_arena_slab *next;
+    size_t used;
+    size_t size;
+} json_arena_slab;
+
+static json_arena_slab *json_arena_slabs = NULL;
+
+static void *json_arena_malloc(size_t size)
+{
+    json_arena_slab *slab = json_arena_slabs;
+    size_t need = (size + 7) & ~(size_t)7;
+    void *ptr;
+
+    if (slab == NULL || slab->size - slab->used < need) {
+        size_t slab_size = JSON_ARENA_SLAB_SIZE;
+        if (need > slab_size)
+            slab_size = need;
+        slab = malloc(sizeof(json_arena_slab) + slab_size);
+        if (slab == NULL)
+            return NULL;
+        slab->next = json_arena_slabs;
+        slab->used = 0;
+        slab->size = slab_size;
+        json_arena_slabs = slab;
+    }
+
+    ptr = (char *)(slab + 1) + slab->used;
+    slab->used += need;
+    return ptr;
+}
+
+static void json_arena_free(void *ptr)
+{
+    (void)ptr;          /* the whole arena is released at once */
+}
+
+void json_arena_init(void)
+{
+    cJSON_Hooks hooks = { json_arena_malloc, json_arena_free };
+    cJSON_InitHooks(&hooks);
+    json_arena_active = 1;
+}
+
+void json_arena_release(void)
+{
+    json_arena_slab *keep = json_arena_slabs;
+    json_arena_slab *slab;
+
+    /* keep the newest slab for reuse so back-to-back dumps in one process
+       don't fault in a fresh slab each time */
+    if (keep == NULL)
+        return;
+    slab = keep->next;
+    keep->used = 0;
+    keep->next = NULL;
+
+    while (slab != NULL) {
+        json_arena_slab *next = slab->next;
+        free(slab);
+        slab = next;
+    }
+    json_arena_slabs = keep;
+}
+
+/* Output writer: stdio's default buffer flushes every few KB, which turns
+   the per-line logging and the byte-wise sidecar writes into a syscall
+   every few hundred values, and cJSON_Print grows a fresh string by
+   doubling for every document, a transient spike of roughly twice the
+   document size at the end of every run.  Each output file gets one
+   multi-MB user-space buffer instead, and trees are serialized with
+   cJSON_PrintPreallocated into a grow-only buffer that is reused across
+   documents and across batch entries. */
+
+#define OUTPUT_BUFFER_SIZE (4 * 1024 * 1024)
+
+static char *json_print_buffer = NULL;
+static size_t json_print_buffer_size = 0;
+
+void output_buffer_attach(FILE *file)
+{
+    if (file)
+        setvbuf(file, NULL, _IOFBF, OUTPUT_BUFFER_SIZE);
+}
+
+static void write_json(cJSON *json, FILE *file, int formatted)
+{
+    if (file == NULL || json == NULL)
+        return;
+    if (json_print_buffer == NULL) {
+        json_print_buffer_size = OUTPUT_BUFFER_SIZE;
+        json_print_buffer = malloc(json_print_buffer_size);
+    }
+    while (json_print_buffer != NULL &&
+           !cJSON_PrintPreallocated(json, json_print_buffer,
+                                    (int)json_print_buffer_size, formatted)) {
+        free(json_print_buffer);
+        json_print_buffer_size *= 2;
+        json_print_buffer = malloc(json_print_buffer_size);
+    }
+    if (json_print_buffer == NULL) {
+        fprintf(stderr, "memory allocation failure\n");
+        json_print_buffer_size = 0;
+        return;
+    }
+    fwrite(json_print_buffer, 1, strlen(json_print_buffer), file);
+    fflush(file);
+}
+
+void write_json_to_file(cJSON *json, FILE *file)
+{
+    if (binary_format_enable) {
+        write_binary_to_file(json, file);
+        return;
+    }
+    write_json(json, file, 1);
+}
+
+void write_json_to_file_compact(cJSON *json, FILE *file)
+{
+    if (binary_format_enable) {
+        write_binary_to_file(json, file);
+        return;
+    }
+    write_json(json, file, 0);
+}
+
+/* --format=binary: emit the structure tree in a compact length-prefixed
+   binary encoding instead of JSON text, written straight from the tree so
+   no text is built at all.  Like the other sidecar caches this is a local
+   host-endian format, not an interchange format; cfb2json converts it
+   back to JSON for human inspection.  Layout: a u32 magic, then one
+   value.  A value is a one-byte tag followed by:
+     object  - u32 count, then count * (u32 name length, name, value)
+     array   - u32 count, then count * value
+     f64     - 8-byte double
+     string  - u32 length, then the bytes
+     u8      - one byte (most dump numbers are byte values)
+     i32     - 4-byte int */
+
+#define CFB_MAGIC 0x31424643U  /* "CFB1" */
+
+#define CFB_TAG_OBJECT 1
+#define CFB_TAG_ARRAY  2
+#define CFB_TAG_F64    3
+#define CFB_TAG_STRING 4
+#define CFB_TAG_U8     5
+#define CFB_TAG_I32    6
+
+unsigned char binary_format_enable = 0;
+
+static void cfb_write_u32(unsigned int val, FILE *file)
+{
+    fwrite(&val, sizeof(val), 1, file);
+}
+
+static void cfb_write_value(cJSON *item, FILE *file)
+{
+    cJSON *child;
+    unsigned int count;
+
+    if (cJSON_IsObject(item) || cJSON_IsArray(item)) {
+        int is_object = cJSON_IsObject(item);
+
+        fputc(is_object ? CFB_TAG_OBJECT : CFB_TAG_ARRAY, file);
+        count = 0;
+        for (child = item->child; child != NULL; child = child->next)
+            count++;
+        cfb_write_u32(count, file);
+        for (child = item->child; child != NULL; child = child->next) {
+            if (is_object) {
+                unsigned int name_len =
+                    child->string == NULL ? 0 : strlen(child->string);
+
+                cfb_write_u32(name_len, file);
+                fwrite(child->string, 1, name_len, file);
+            }
+            cfb_write_value(child, file);
+        }
+    } else if (cJSON_IsNumber(item)) {
+        double value = item->valuedouble;
+
+        if (value >= 0 && value <= 255 && value == (double)(long)value) {
+            fputc(CFB_TAG_U8, file);
+            fputc((int)value, file);
+        } else if (value >= -2147483648.0 && value <= 2147483647.0 &&
+                   value == (double)(long)value) {
+            int ival = (int)value;
+
+            fputc(CFB_TAG_I32, file);
+            fwrite(&ival, sizeof(ival), 1, file);
+        } else {
+            fputc(CFB_TAG_F64, file);
+            fwrite(&value, sizeof(value), 1, file);
+        }
+    } else if (cJSON_IsString(item)) {
+        unsigned int len = strlen(item->valuestring);
+
+        fputc(CFB_TAG_STRING, file);
+        cfb_write_u32(len, file);
+        fwrite(item->valuestring, 1, len, file);
+    } else {
+        /* the dumps only build objects, arrays, numbers and strings */
+        double zero = 0;
+
+        fputc(CFB_TAG_F64, file);
+        fwrite(&zero, sizeof(zero), 1, file);
+    }
+}
+
+void write_binary_to_file(cJSON *json, FILE *file)
+{
+    if (file == NULL || json == NULL)
+        return;
+    cfb_write_u32(CFB_MAGIC, file);
+    cfb_write_value(json, file);
+    fflush(file);
+}
+
+static char *cfb_read_bytes(unsigned int len, FILE *file)
+{
+    char *buffer = malloc((size_t)len + 1);
+
+    if (buffer == NULL)
+        return NULL;
+    if (fread(buffer, 1, len, file) != len) {
+        free(buffer);
+        return NULL;
+    }
+    buffer[len] = 0;
+    return buffer;
+}
+
+static cJSON *cfb_read_value(FILE *file)
+{
+    int tag = fgetc(file);
+    unsigned int count, len, i;
+    cJSON *item, *child;
+    char *buffer;
+    double dval;
+    int ival;
+
+    switch (tag) {
+    case CFB_TAG_OBJECT:
+    case CFB_TAG_ARRAY:
+        if (fread(&count, sizeof(count), 1, file) != 1)
+            return NULL;
+        item = tag == CFB_TAG_OBJECT ? cJSON_CreateObject()
+                                     : cJSON_CreateArray();
+        for (i = 0; item != NULL && i < count; i++) {
+            if (tag == CFB_TAG_OBJECT) {
+                if (fread(&len, sizeof(len), 1, file) != 1 ||
+                    (buffer = cfb_read_bytes(len, file)) == NULL) {
+                    cJSON_Delete(item);
+                    return NULL;
+                }
+                child = cfb_read_value(file);
+                if (child != NULL)
+                    cJSON_AddItemToObject(item, buffer, child);
+                free(buffer);
+            } else {
+                child = cfb_read_value(file);
+                if (child != NULL)
+                    cJSON_AddItemToArray(item, child);
+            }
+            if (child == NULL) {
+                cJSON_Delete(item);
+                return NULL;
+            }
+        }
+        return item;
+    case CFB_TAG_F64:
+        if (fread(&dval, sizeof(dval), 1, file) != 1)
+            return NULL;
+        return cJSON_CreateNumber(dval);
+    case CFB_TAG_STRING:
+        if (fread(&len, sizeof(len), 1, file) != 1 ||
+            (buffer = cfb_read_bytes(len, file)) == NULL)
+            return NULL;
+        item = cJSON_CreateString(buffer);
+        free(buffer);
+        return item;
+    case CFB_TAG_U8:
+        ival = fgetc(file);
+        return ival == EOF ? NULL : cJSON_CreateNumber(ival);
+    case CFB_TAG_I32:
+        if (fread(&ival, sizeof(ival), 1, file) != 1)
+            return NULL;
+        return cJSON_CreateNumber(ival);
+    default:
+        return NULL;
+    }
+}
+
+cJSON *read_binary_from_file(FILE *file)
+{
+    unsigned int magic;
+
+    if (file == NULL || fread(&magic, sizeof(magic), 1, file) != 1 ||
+        magic != CFB_MAGIC)
+        return NULL;
+    return cfb_read_value(file);
+}
+
+/* --stats: cheap counters and wall-clock timers so a regression can be
+   pinned on a subsystem (bit reading, table construction, symbol/sequence
+   execution, JSON serialization) without an external profiler.  All hooks
+   are gated on stats_enable so the normal path pays one predictable branch
+   at most. */
+unsigned char stats_enable = 0;
+double stats_table_build_time = 0;
+double stats_symbol_exec_time = 0;
+double stats_json_write_time = 0;
+unsigned long long stats_bit_reader_calls = 0;
+unsigned long long stats_bit_reader_bits = 0;
+unsigned long long stats_in_bytes = 0;
+unsigned long long stats_out_bytes = 0;
+
+double stats_now(void)
+{
+#if defined(_WIN32) || defined(WIN32)
+    return (double)clock() / CLOCKS_PER_SEC;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+#endif
+}
+
+void stats_reset(void)
+{
+    stats_table_build_time = 0;
+    stats_symbol_exec_time = 0;
+    stats_json_write_time = 0;
+    stats_bit_reader_calls = 0;
+    stats_bit_reader_bits = 0;
+    stats_in_bytes = 0;
+    stats_out_bytes = 0;
+}
+
+/* Write the accumulated counters as a small JSON file next to the other
+   per-input outputs.  Written with fprintf rather than cJSON so the stats
+   file itself never shows up in the JSON serialization timer. */
+void stats_dump(const char *file_name)
+{
+    FILE *file = fopen(file_name, "w");
+
+    if (file == NULL)
+        return;
+    fprintf(file, "{\n");
+    fprintf(file, "\t\"bytes_in\":\t%llu,\n", stats_in_bytes);
+    fprintf(file, "\t\"bytes_out\":\t%llu,\n", stats_out_bytes);
+    fprintf(file, "\t\"bit_reader_calls\":\t%llu,\n", stats_bit_reader_calls);
+    fprintf(file, "\t\"bit_reader_bits\":\t%llu,\n", stats_bit_reader_bits);
+    fprintf(file, "\t\"table_build_seconds\":\t%.6f,\n", stats_table_build_time);
+    fprintf(file, "\t\"symbol_exec_seconds\":\t%.6f,\n", stats_symbol_exec_time);
+    fprintf(file, "\t\"json_write_seconds\":\t%.6f\n", stats_json_write_time);
+    fprintf(file, "}\n");
+    fclose(file);
 }
@@ -14,25 +14,97 @@ extern FILE *decompressed_data_file;
 extern cJSON *compressed_data_json;
 extern cJSON *decompressed_data_json;
 
+extern FILE *json_stream_file;
+extern unsigned char json_stream_enable;
+extern unsigned char scan_only;
+extern unsigned char stream_window_enable;
+
+extern FILE *binary_sidecar_file;
+extern unsigned char binary_sidecar_enable;
+extern unsigned long binary_sidecar_offset;
+
+void sidecar_ref_to_json(cJSON* json, const char *const name,
+                         unsigned long start_offset, int element_size);
+
 extern char *print_level_tabel[];
 extern unsigned char print_data_verbose;
 
+/* detail tiers for the -d option; each level includes the ones below it.
+   The default keeps the legacy all-or-nothing -v behavior. */
+#define PRINT_DETAIL_HEADERS   0   /* headers, summaries and small fields */
+#define PRINT_DETAIL_TABLES    1   /* + extracted Huffman table contents */
+#define PRINT_DETAIL_SEQUENCES 2   /* + per-symbol encoded streams */
+#define PRINT_DETAIL_BYTES     3   /* + raw and decompressed byte arrays */
+extern unsigned char print_detail_level;
+
 extern unsigned int adler32_checksum;
+extern unsigned int crc32_checksum;
+extern unsigned char crc32_enable;
 
 void print_to_compressed_log(char *fmt, ...);
 void print_to_decompressed_log(char *fmt, ...);
 
-void print_compressed_data_hex(int data_val, cJSON* json);
+void print_compressed_data_hex(int data_val, cJSON* json, int min_level);
 void print_compressed_data_dec(int data_val, int print_level);
 
-void print_decompressed_data_hex(int data_val, cJSON* json);
+void print_decompressed_data_hex(int data_val, cJSON* json, int min_level);
 
 void dump_data_to_json(cJSON* json, const char *const name, unsigned char *buffer, unsigned int num);
+void add_number_array_bulk(cJSON* array, const unsigned char *buffer, unsigned int num);
 void addStringToObjectFormatted(cJSON* json, const char *const name, const char *const format, ...);
+
+extern cJSON *block_index_json;
+extern unsigned char block_index_enable;
+
+extern unsigned long range_offset;
+extern unsigned long range_len;
+extern unsigned char range_enable;
+
+extern unsigned char tolerant_enable;
+
+extern unsigned char binary_format_enable;
+
+void output_buffer_attach(FILE *file);
+void write_json_to_file(cJSON *json, FILE *file);
+void write_json_to_file_compact(cJSON *json, FILE *file);
+void write_binary_to_file(cJSON *json, FILE *file);
+cJSON *read_binary_from_file(FILE *file);
+
+void jw_begin_document(FILE *file);
+void jw_end_document(void);
+void jw_begin_object(const char *const name);
+void jw_end_object(void);
+void jw_begin_array(const char *const name);
+void jw_end_array(void);
+void jw_add_number(const char *const name, double value);
+void jw_add_string(const char *const name, const char *const value);
+void jw_add_string_formatted(const char *const name, const char *const format, ...);
+void jw_add_array_number(double value);
 void print_log_to_both(char *fmt, ...);
 void print_hex_with_buffer(unsigned char *buffer, unsigned int num, int print_level);
 
+void *map_file(const char *name, size_t *len);
+void unmap_file(void *addr, size_t len);
+
+void json_arena_init(void);
+void json_arena_release(void);
+
+extern unsigned char stats_enable;
+extern double stats_table_build_time;
+extern double stats_symbol_exec_time;
+extern double stats_json_write_time;
+extern unsigned long long stats_bit_reader_calls;
+extern unsigned long long stats_bit_reader_bits;
+extern unsigned long long stats_in_bytes;
+extern unsigned long long stats_out_bytes;
+
+double stats_now(void);
+void stats_reset(void);
+void stats_dump(const char *file_name);
+
 unsigned int swap_uint32(unsigned int val);
-void adler32(unsigned char data_val);
+void adler32_update(const unsigned char *buffer, unsigned int num);
+void crc32_update(const unsigned char *buffer, unsigned int num);
+void checksum_update(const unsigned char *buffer, unsigned int num);
 
 #endif
\ No newline at end of file
@@ -29,6 +29,11 @@
 #  define SET_BINARY_MODE(file)
 #endif
 
+#if !defined(_WIN32) && !defined(WIN32)
+#  include <pthread.h>
+#  define HAVE_STREAM_WORKERS 1
+#endif
+
 #define local static
 
 /* Return size times approximately the cube root of 2, keeping the result as 1,
@@ -213,37 +218,103 @@ int zlib_dump(unsigned char *dest,
     return ret;
 }
 
-int main(int argc, char **argv)
+/* Find the next zlib stream start candidate at or after offset from.
+   The header decoder only accepts CM 8 with a 32K window, so a candidate
+   is the 0x78 CMF byte followed by a FLG byte that makes CMF*256+FLG a
+   multiple of 31.  That check can also match bytes inside payload data,
+   so candidates are never trusted directly: the pre-scan in dump_file()
+   measures where each stream really ends with a decode.  Returns len
+   when no further candidates. */
+local size_t next_stream_offset(const unsigned char *source, size_t len,
+                                size_t from)
+{
+    size_t at;
+
+    for (at = from; at + 2 <= len; at++)
+        if (source[at] == 0x78 &&
+            (source[at] * 256 + source[at + 1]) % 31 == 0)
+            return at;
+    return len;
+}
+
+/* One independent zlib stream of a concatenated input, with its input
+   slice and private JSON sub-tree so streams can be decoded on worker
+   threads and merged in order afterwards */
+typedef struct {
+    size_t offset;
+    size_t csize;
+    const unsigned char *src;
+    cJSON *json;
+    unsigned long destlen;
+    unsigned int adler_calculated;
+    int in_range;
+    int ret;
+} stream_job_s;
+
+#ifdef HAVE_STREAM_WORKERS
+typedef struct {
+    stream_job_s *jobs;
+    int num_jobs;
+    int next_job;
+    pthread_mutex_t lock;
+} stream_pool_s;
+
+static void *stream_worker(void *arg)
+{
+    stream_pool_s *const pool = arg;
+    int job_index;
+
+    for (;;) {
+        pthread_mutex_lock(&pool->lock);
+        job_index = pool->next_job++;
+        pthread_mutex_unlock(&pool->lock);
+        if (job_index >= pool->num_jobs)
+            return NULL;
+
+        stream_job_s *const job = &pool->jobs[job_index];
+        job->ret = zlib_dump(NIL, &job->destlen, job->src, job->csize,
+                             job->json);
+    }
+}
+#endif
+
+/* Dump one input file; in batch mode this is called once per listed name so
+   process startup and the allocation context are paid for only once. */
+local int dump_file(const char *name, int put, int wr_file, int stream_win,
+                    int num_threads)
 {
-    int ret, put = 0, i, wr_file = 0;
+    int ret = 0, single_pass, i;
+    int num_streams = 0, stream_cap = 0;
+    size_t stream_start;
+    stream_job_s *streams = NULL, *stream_grow;
+    unsigned char scan_hold = 0, stream_hold = 0, sidecar_hold = 0,
+        index_hold = 0, stats_hold = 0, tolerant_hold = 0, range_hold = 0;
+    unsigned int adler_hold = 0;
+    unsigned long total_written;
     unsigned file_name_len = 0;
-    char *arg, *name = NULL;
     unsigned char *source = NULL, *dest;
-    size_t len = 0;
+    size_t len = 0, maplen = 0;
+    int source_mapped = 0;
     unsigned long destlen;
     char compressed_log_file_name[250] = {0};
     char decompressed_log_file_name[250] = {0};
     char decompressed_file_name[250] = {0};
-
-    /* process arguments */
-    while (arg = *++argv, --argc)
-        if (arg[0] == '-') {
-            if (arg[1] == 'w' && arg[2] == 0)
-                put = 1, wr_file = 1;
-            else if (arg[1] == 'v' && arg[2] == 0)
-                put = 1, print_data_verbose = 1;
-            else {
-                fprintf(stderr, "invalid option %s\n", arg);
-                return 3;
-            }
-        }
-        else if (name != NULL) {
-            fprintf(stderr, "only one file name allowed\n");
-            return 3;
-        }
-        else
-            name = arg;
-    source = load(name, &len);
+    char stream_log_file_name[250] = {0};
+    char binary_sidecar_file_name[250] = {0};
+    char stats_log_file_name[250] = {0};
+    char block_index_file_name[250] = {0};
+    FILE *stream_file = NULL;
+    cJSON *index_root_json = NULL;
+
+
+    adler32_checksum = 1;
+    source = map_file(name, &maplen);
+    if (source != NULL) {
+        len = maplen;
+        source_mapped = 1;
+    } else {
+        source = load(name, &len);
+    }
     if (source == NULL) {
         fprintf(stderr, "memory allocation failure\n");
         return 4;
@@ -260,61 +331,469 @@ int main(int argc, char **argv)
         strcpy(compressed_log_file_name, name);
         strcpy(decompressed_log_file_name, name);
         strcpy(decompressed_file_name, name);
-        strcat (compressed_log_file_name, "_compressed.json");
-        strcat (decompressed_log_file_name, "_decompressed.json");
+        strcpy(stream_log_file_name, name);
+        strcpy(binary_sidecar_file_name, name);
+        strcpy(stats_log_file_name, name);
+        strcpy(block_index_file_name, name);
+        strcat (compressed_log_file_name, binary_format_enable ?
+                "_compressed.cfb" : "_compressed.json");
+        strcat (decompressed_log_file_name, binary_format_enable ?
+                "_decompressed.cfb" : "_decompressed.json");
         strcat (decompressed_file_name, "_decompressed.bin");
+        strcat (stream_log_file_name, "_stream.json");
+        strcat (binary_sidecar_file_name, "_data.bin");
+        strcat (stats_log_file_name, "_stats.json");
+        strcat (block_index_file_name, binary_format_enable ?
+                "_index.cfb" : "_index.json");
     } else {
-        strcat (compressed_log_file_name, "zlib_compressed.json");
-        strcat (decompressed_log_file_name, "zlib_decompressed.json");
+        strcat (compressed_log_file_name, binary_format_enable ?
+                "zlib_compressed.cfb" : "zlib_compressed.json");
+        strcat (decompressed_log_file_name, binary_format_enable ?
+                "zlib_decompressed.cfb" : "zlib_decompressed.json");
         strcat (decompressed_file_name, "zlib_decompressed.bin");
+        strcat (stream_log_file_name, "zlib_stream.json");
+        strcat (binary_sidecar_file_name, "zlib_data.bin");
+        strcat (stats_log_file_name, "zlib_stats.json");
+        strcat (block_index_file_name, binary_format_enable ?
+                "zlib_index.cfb" : "zlib_index.json");
+    }
+
+    if (json_stream_enable) {
+        stream_file = fopen(stream_log_file_name, "w");
+        jw_begin_document(stream_file);
+    }
+
+    if (binary_sidecar_enable) {
+        binary_sidecar_file = fopen(binary_sidecar_file_name, "wb");
+        output_buffer_attach(binary_sidecar_file);
+        binary_sidecar_offset = 0;
+    }
+
+    /* the arena bump allocator is not thread safe, so parallel decodes
+       keep the system allocator */
+    if (num_threads <= 1)
+        json_arena_init();
+
+    if (stats_enable) {
+        stats_reset();
+        stats_in_bytes = len;
+    }
+
+    /* pre-scan for stream boundaries, so concatenated inputs can be split
+       into independent decode jobs.  Candidates from the byte scan can be
+       false hits inside payload data, so when any exist the real end of
+       each stream is measured with a structure-only decode and the next
+       stream starts where the previous one actually ended; single-stream
+       inputs (no later candidates) skip the measuring decodes */
+    int multi_candidates = next_stream_offset(source, len, 8) < len;
+    if (multi_candidates) {
+        /* mask everything the measuring decodes would otherwise emit or
+           clobber; the real decodes below restore and redo it all */
+        scan_hold = scan_only, stream_hold = json_stream_enable;
+        sidecar_hold = binary_sidecar_enable, index_hold = block_index_enable;
+        stats_hold = stats_enable, tolerant_hold = tolerant_enable;
+        range_hold = range_enable;
+        adler_hold = adler32_checksum;
+        scan_only = 1;
+        json_stream_enable = 0;
+        binary_sidecar_enable = 0;
+        block_index_enable = 0;
+        stats_enable = 0;
+        tolerant_enable = 0;
+        range_enable = 0;
+    }
+    stream_start = 0;
+    while (stream_start < len) {
+        size_t stream_end = len;
+
+        if (num_streams == stream_cap) {
+            stream_cap = stream_cap ? stream_cap * 2 : 16;
+            stream_grow = realloc(streams, stream_cap * sizeof(stream_job_s));
+            if (stream_grow == NULL) {
+                fprintf(stderr, "memory allocation failure\n");
+                free(streams);
+                return 4;
+            }
+            streams = stream_grow;
+        }
+        streams[num_streams].offset = stream_start;
+        streams[num_streams].src = source + stream_start;
+        if (multi_candidates && stream_start + 2 <= len &&
+            source[stream_start] == 0x78 &&
+            (source[stream_start] * 256 + source[stream_start + 1]) % 31 == 0) {
+            unsigned long measured_in = len - stream_start - 2;
+            unsigned long measured_out = 0;
+            cJSON *measure_json = cJSON_CreateObject();
+            int err = puff(NIL, &measured_out, source + stream_start + 2,
+                           &measured_in, measure_json);
+
+            cJSON_Delete(measure_json);
+            if (err == 0) {
+                stream_end = stream_start + 2 + measured_in + 4;
+                if (stream_end > len)
+                    stream_end = len;
+            }
+            /* an undecodable stream keeps the rest as one slice, so the
+               real decode below reports the error at the right offset */
+        }
+        streams[num_streams].csize = stream_end - stream_start;
+        num_streams++;
+        stream_start = stream_end;
+    }
+    if (multi_candidates) {
+        scan_only = scan_hold;
+        json_stream_enable = stream_hold;
+        binary_sidecar_enable = sidecar_hold;
+        block_index_enable = index_hold;
+        stats_enable = stats_hold;
+        tolerant_enable = tolerant_hold;
+        range_enable = range_hold;
+        adler32_checksum = adler_hold;
+    }
+
+    /* without -v both JSON files carry the same block structure, so the
+       output can be produced in the same decode that builds the JSON and
+       the second full decode is skipped entirely */
+    single_pass = put && !print_data_verbose;
+    if (single_pass) {
+        decompressed_data_file = fopen(decompressed_file_name, "wb");
+        stream_window_enable = 1;
     }
 
     compressed_data_log_file = fopen(compressed_log_file_name, "w");
     compressed_data_json = cJSON_CreateObject();
 
-    ret = zlib_dump(NIL, &destlen, source, len, compressed_data_json);
+    if (block_index_enable) {
+        index_root_json = cJSON_CreateObject();
+        cJSON_AddStringToObject(index_root_json, "window_note",
+                                "entries hold no window snapshot; a restart "
+                                "at an entry must first reconstruct output "
+                                "from its window_from byte onward");
+        block_index_json = cJSON_AddArrayToObject(index_root_json, "BLOCK_INDEX");
+    }
 
-    char* jsonString = cJSON_Print(compressed_data_json);
-    if (compressed_data_log_file) {
-        fprintf(compressed_data_log_file, "%s", jsonString);
+    /* single-stream inputs keep the original JSON layout, concatenated
+       inputs get one entry per stream under ZLIB_STREAMS, in file order */
+    cJSON* streams_json = NULL;
+    if (num_streams > 1)
+        streams_json = cJSON_AddArrayToObject(compressed_data_json, "ZLIB_STREAMS");
+    for (i = 0; i < num_streams; i++) {
+        streams[i].destlen = 0;
+        streams[i].ret = 0;
+        streams[i].in_range = !range_enable ||
+            (streams[i].offset < range_offset + range_len &&
+             streams[i].offset + streams[i].csize > range_offset);
+        if (num_streams > 1) {
+            if (streams[i].in_range) {
+                streams[i].json = cJSON_CreateObject();
+                cJSON_AddItemToArray(streams_json, streams[i].json);
+            } else {
+                streams[i].json = NULL;
+            }
+        } else {
+            streams[i].json = compressed_data_json;
+        }
     }
-    cJSON_free(jsonString);
-    cJSON_Delete(compressed_data_json);
+
+    /* stream offsets are file absolute but puff()'s bit positions are
+       stream relative, so the window gates whole streams here and is
+       hidden from the deflate-level filter for the decodes below */
+    int range_active = range_enable;
+    range_enable = 0;
+
+#ifdef HAVE_STREAM_WORKERS
+    if (num_threads > 1 && num_streams > 1 && !single_pass &&
+        !json_stream_enable && !stats_enable && !binary_sidecar_enable &&
+        !block_index_enable && !range_active) {
+        /* this pass only sizes the output, so streams can be decoded
+           concurrently; the single-pass window writer, the stream writer,
+           the block index array and the sidecar offset are shared state
+           and the --stats counters are unsynchronized, so those modes
+           fall through to the sequential loop below */
+        stream_pool_s pool = { .jobs = streams, .num_jobs = num_streams,
+                               .next_job = 0 };
+        pthread_mutex_init(&pool.lock, NULL);
+        if (num_threads > num_streams)
+            num_threads = num_streams;
+        pthread_t* const workers = malloc(num_threads * sizeof(pthread_t));
+        if (workers == NULL) {
+            fprintf(stderr, "memory allocation failure\n");
+            return 4;
+        }
+        for (i = 0; i < num_threads; i++)
+            pthread_create(&workers[i], NULL, stream_worker, &pool);
+        for (i = 0; i < num_threads; i++)
+            pthread_join(workers[i], NULL);
+        free(workers);
+        pthread_mutex_destroy(&pool.lock);
+
+        for (i = 0; i < num_streams; i++)
+            if (streams[i].ret)
+                ret = streams[i].ret;
+    } else
+#endif
+    for (i = 0; i < num_streams; i++) {
+        if (!streams[i].in_range) {
+            if (range_active && streams[i].offset >= range_offset + range_len)
+                break;          /* streams are in file order */
+            continue;
+        }
+        if (single_pass) {
+            /* the stream window feeds the output through the running
+               checksum, so reset it per stream like the second pass */
+            adler32_checksum = 1;
+        }
+        streams[i].ret = zlib_dump(NIL, &streams[i].destlen, streams[i].src,
+                                   streams[i].csize, streams[i].json);
+        if (single_pass)
+            streams[i].adler_calculated = swap_uint32(adler32_checksum);
+        if (streams[i].ret)
+            ret = streams[i].ret;
+    }
+
+    destlen = 0;
+    for (i = 0; i < num_streams; i++)
+        destlen += streams[i].destlen;
+    if (ret == 0)
+        stats_out_bytes = destlen;
+
+    double stats_t0 = stats_enable ? stats_now() : 0;
+    write_json_to_file(compressed_data_json, compressed_data_log_file);
+    if (stats_enable)
+        stats_json_write_time += stats_now() - stats_t0;
+
+    if (single_pass) {
+        stream_window_enable = 0;
+        fclose(decompressed_data_file);
+        decompressed_data_file = NULL;
+        if (ret == 0) {
+            /* reuse the tree for the decompressed log, plus the per-stream
+               checksums computed through the stream window above; they go
+               in only now so the compressed log written before this stays
+               identical to the two-pass layout */
+            for (i = 0; i < num_streams; i++) {
+                if (!streams[i].in_range)
+                    continue;
+                cJSON* zlib_format_json = cJSON_GetObjectItem(streams[i].json, "ZLIB_FORMAT");
+                cJSON* checksum_calculated_json = cJSON_AddObjectToObject(zlib_format_json, "CHECKSUM_CALCULATED");
+                dump_data_to_json(checksum_calculated_json, "value", (unsigned char *)&streams[i].adler_calculated, 4);
+                cJSON_AddStringToObject(checksum_calculated_json, "description", "Adler-32 Checksum Calculated");
+            }
+            decompressed_data_log_file = fopen(decompressed_log_file_name, "w");
+            stats_t0 = stats_enable ? stats_now() : 0;
+            write_json_to_file(compressed_data_json, decompressed_data_log_file);
+            if (stats_enable)
+                stats_json_write_time += stats_now() - stats_t0;
+            fclose(decompressed_data_log_file);
+            decompressed_data_log_file = NULL;
+        }
+    }
+
+    /* the index entries live with the rest of the tree, so the compact
+       sidecar has to go out before the tree is torn down below */
+    if (index_root_json != NULL) {
+        FILE *index_file = fopen(block_index_file_name, "w");
+        write_json_to_file_compact(index_root_json, index_file);
+        fclose(index_file);
+        block_index_json = NULL;
+        if (num_threads > 1)
+            cJSON_Delete(index_root_json);
+        index_root_json = NULL;
+    }
+
+    if (num_threads <= 1)
+        json_arena_release();
+    else
+        cJSON_Delete(compressed_data_json);
     fclose(compressed_data_log_file);
     compressed_data_log_file = NULL;
     compressed_data_json = NULL;
 
     /* if requested, inflate again and write decompressed data to stdout */
-    if (put && ret == 0) {
-        dest = malloc(destlen);
-        if (dest == NULL) {
-            fprintf(stderr, "memory allocation failure\n");
-            return 4;
+    if (put && ret == 0 && !single_pass) {
+        if (stream_win) {
+            /* stream through puff's 32K window straight into the output
+               file, so memory stays constant however large the content */
+            decompressed_data_file = fopen(decompressed_file_name, "wb");
+            stream_window_enable = 1;
+            dest = NIL;
+        }
+        else {
+            dest = malloc(destlen);
+            if (dest == NULL) {
+                fprintf(stderr, "memory allocation failure\n");
+                return 4;
+            }
         }
 
         decompressed_data_log_file = fopen(decompressed_log_file_name, "w");
         decompressed_data_json = cJSON_CreateObject();
-        zlib_dump(dest, &destlen, source, len, decompressed_data_json);
-        char* jsonString = cJSON_Print(decompressed_data_json);
-        if (decompressed_data_log_file) {
-            fprintf(decompressed_data_log_file, "%s", jsonString);
+        streams_json = NULL;
+        if (num_streams > 1)
+            streams_json = cJSON_AddArrayToObject(decompressed_data_json, "ZLIB_STREAMS");
+        total_written = 0;
+        for (i = 0; i < num_streams; i++) {
+            cJSON* stream_json = decompressed_data_json;
+            unsigned long stream_len = streams[i].destlen;
+            if (!streams[i].in_range)
+                continue;
+            if (num_streams > 1) {
+                stream_json = cJSON_CreateObject();
+                cJSON_AddItemToArray(streams_json, stream_json);
+            }
+            adler32_checksum = 1;
+            zlib_dump(dest == NIL ? NIL : dest + total_written, &stream_len,
+                      streams[i].src, streams[i].csize, stream_json);
+            total_written += stream_len;
         }
-        cJSON_free(jsonString);
-        cJSON_Delete(decompressed_data_json);
+        destlen = total_written;
+        double stats_t1 = stats_enable ? stats_now() : 0;
+        write_json_to_file(decompressed_data_json, decompressed_data_log_file);
+        if (stats_enable)
+            stats_json_write_time += stats_now() - stats_t1;
+        if (num_threads <= 1)
+            json_arena_release();
+        else
+            cJSON_Delete(decompressed_data_json);
         fclose(decompressed_data_log_file);
         decompressed_data_log_file = NULL;
         decompressed_data_json = NULL;
 
-        if (wr_file) {
+        if (stream_win) {
+            stream_window_enable = 0;
+            fclose(decompressed_data_file);
+            decompressed_data_file = NULL;
+        }
+        else if (wr_file) {
             decompressed_data_file = fopen(decompressed_file_name, "wb");
             fwrite(dest, 1, destlen, decompressed_data_file);
             fclose(decompressed_data_file);
+            decompressed_data_file = NULL;
         }
 
         free(dest);
     }
 
+    if (stream_file) {
+        jw_end_document();
+        fclose(stream_file);
+    }
+
+    if (binary_sidecar_file) {
+        fclose(binary_sidecar_file);
+        binary_sidecar_file = NULL;
+    }
+
+    if (stats_enable)
+        stats_dump(stats_log_file_name);
+
     /* clean up */
-    free(source);
+    range_enable = range_active;
+    free(streams);
+    if (source_mapped)
+        unmap_file(source, maplen);
+    else
+        free(source);
     return ret;
 }
+
+/* Read the next file name from a batch list.  Names are separated by
+   newlines or NULs so both plain lists and find -print0 output work. */
+local int next_list_name(FILE *list, char *name, size_t size)
+{
+    int c;
+    size_t n = 0;
+
+    while ((c = getc(list)) != EOF) {
+        if (c == '\n' || c == '\r' || c == '\0') {
+            if (n)
+                break;
+            continue;
+        }
+        if (n + 1 < size)
+            name[n++] = c;
+    }
+    name[n] = 0;
+    return n > 0;
+}
+
+int main(int argc, char **argv)
+{
+    int ret = 0, put = 0, wr_file = 0, batch = 0, stream_win = 0;
+    int num_threads = 1;
+    char *arg, *name = NULL;
+
+    /* process arguments */
+    while (arg = *++argv, --argc)
+        if (arg[0] == '-') {
+            if (arg[1] == 'w' && arg[2] == 0)
+                put = 1, wr_file = 1;
+            else if (arg[1] == 'v' && arg[2] == 0)
+                put = 1, print_data_verbose = 1;
+            else if (arg[1] == 'd' && arg[2] >= '0' && arg[2] <= '3'
+                     && arg[3] == 0)
+                put = 1, print_data_verbose = 1,
+                    print_detail_level = arg[2] - '0';
+            else if (arg[1] == 's' && arg[2] == 0)
+                json_stream_enable = 1;
+            else if (strcmp(arg, "--scan") == 0)
+                scan_only = 1;
+            else if (strcmp(arg, "--stats") == 0)
+                stats_enable = 1;
+            else if (strcmp(arg, "--index") == 0)
+                block_index_enable = 1;
+            else if (strcmp(arg, "--range") == 0 && argc > 1) {
+                char *colon;
+                arg = *++argv, --argc;
+                range_offset = strtoul(arg, &colon, 0);
+                if (*colon != ':') {
+                    fprintf(stderr, "invalid --range, expected OFFSET:LEN\n");
+                    return 3;
+                }
+                range_len = strtoul(colon + 1, NULL, 0);
+                range_enable = 1;
+            }
+            else if (strcmp(arg, "--tolerant") == 0)
+                tolerant_enable = 1;
+            else if (strcmp(arg, "--format=binary") == 0)
+                binary_format_enable = 1;
+            else if (arg[1] == 'b' && arg[2] == 0)
+                binary_sidecar_enable = 1;
+            else if (arg[1] == 'B' && arg[2] == 0)
+                batch = 1;
+            else if (arg[1] == 'W' && arg[2] == 0)
+                put = 1, stream_win = 1;
+            else if (arg[1] == 'j' && arg[2] >= '1' && arg[2] <= '9')
+                num_threads = atoi(arg + 2);
+            else {
+                fprintf(stderr, "invalid option %s\n", arg);
+                return 3;
+            }
+        }
+        else if (name != NULL) {
+            fprintf(stderr, "only one file name allowed\n");
+            return 3;
+        }
+        else
+            name = arg;
+
+    /* batch mode: the name is a list of inputs (or the list comes from
+       stdin) and each entry gets its own dump in this one process */
+    if (batch) {
+        char list_name[250];
+        FILE *list = name == NULL ? stdin : fopen(name, "r");
+
+        if (list == NULL) {
+            fprintf(stderr, "could not open file list %s\n", name);
+            return 3;
+        }
+        while (next_list_name(list, list_name, sizeof(list_name)))
+            if (dump_file(list_name, put, wr_file, stream_win, num_threads))
+                ret = 1;
+        if (list != stdin)
+            fclose(list);
+        return ret;
+    }
+
+    return dump_file(name, put, wr_file, stream_win, num_threads);
+}
@@ -15,8 +15,16 @@
 #include <stdlib.h>   // malloc, free, exit
 #include <stdio.h>    // fprintf
 #include <string.h>   // memset, memcpy
+#include <setjmp.h>   // setjmp, longjmp
 #include "zstd_decompress.h"
 
+/* --tolerant: when armed, decode errors longjmp back to the caller's
+   recovery point with the message in zdec_error_msg instead of exiting
+   the process, so the structure decoded so far can still be written */
+jmp_buf zdec_recover_env;
+unsigned char zdec_recover_armed = 0;
+const char *zdec_error_msg = NULL;
+
 
 /******* IMPORTANT CONSTANTS *********************************************/
 
@@ -47,6 +55,10 @@
 #define ERROR(s)                                                               \
     do {                                                                       \
         MESSAGE("Error: %s\n", s);                                     \
+        if (zdec_recover_armed) {                                              \
+            zdec_error_msg = s;                                                \
+            longjmp(zdec_recover_env, 1);                                      \
+        }                                                                      \
         exit(1);                                                               \
     } while (0)
 #define INP_SIZE()                                                             \
@@ -162,6 +174,10 @@ typedef struct {
     u8 *symbols;
     u8 *num_bits;
     int max_bits;
+    // Log2 of the allocated entries behind the pointers above; rebuilds fit
+    // in place when it is HUF_MAX_BITS, so repeated table transmissions in a
+    // frame don't malloc/free on every block
+    int capacity_bits;
 } HUF_dtable;
 
 /// Decode a single symbol and read in enough bits to refresh the state
@@ -192,6 +208,10 @@ static void HUF_init_dtable_usingweights(HUF_dtable *const table,
                                          const u8 *const weights,
                                          const int num_symbs);
 
+/// Make sure a table has worst-case (2^HUF_MAX_BITS) storage behind it so
+/// later rebuilds (e.g. a new table transmitted mid-frame) reuse it in place
+static void HUF_reserve_dtable(HUF_dtable *const dtable);
+
 /// Free the malloc'ed parts of a decoding table
 static void HUF_free_dtable(HUF_dtable *const dtable);
 /*** END HUFFMAN PRIMITIVES ***********/
@@ -211,6 +231,9 @@ typedef struct {
     u8 *num_bits;
     u16 *new_state_base;
     int accuracy_log;
+    // Log2 of the allocated entries behind the pointers above; rebuilds fit
+    // in place when it is FSE_MAX_ACCURACY_LOG (see FSE_reserve_dtable)
+    int capacity_log;
 } FSE_dtable;
 
 /// Return the symbol for the current state
@@ -253,6 +276,10 @@ static void FSE_decode_header(FSE_dtable *const dtable, istream_t *const in,
 /// 0 bits per symbol, to be used for RLE mode in sequence commands
 static void FSE_init_dtable_rle(FSE_dtable *const dtable, const u8 symb);
 
+/// Make sure a table has worst-case (2^FSE_MAX_ACCURACY_LOG) storage behind
+/// it so later rebuilds reuse it in place instead of mallocing per table
+static void FSE_reserve_dtable(FSE_dtable *const dtable);
+
 /// Free the malloc'ed parts of a decoding table
 static void FSE_free_dtable(FSE_dtable *const dtable);
 /*** END FSE PRIMITIVES ***************/
@@ -297,6 +324,11 @@ typedef struct {
     FSE_dtable ml_dtable;
     FSE_dtable of_dtable;
 
+    // Scratch table for FSE-compressed Huffman weights, kept here so its
+    // worst-case storage is reused across blocks instead of being allocated
+    // per table description
+    FSE_dtable hufweights_dtable;
+
     // The last 3 offsets for the special "repeat offsets".
     u64 previous_offsets[3];
 } frame_context_t;
@@ -385,14 +417,16 @@ size_t ZSTD_decompress(void *const dst, const size_t dst_len,
                        const void *const src, const size_t src_len) {
     dictionary_t* const uninit_dict = create_dictionary();
     size_t const decomp_size = ZSTD_decompress_with_dict(dst, dst_len, src,
-                                                         src_len, uninit_dict, 0);
+                                                         src_len, uninit_dict, 0,
+                                                         NULL);
     free_dictionary(uninit_dict);
     return decomp_size;
 }
 
 size_t ZSTD_decompress_with_dict(void *const dst, const size_t dst_len,
                                  const void *const src, const size_t src_len,
-                                 dictionary_t* parsed_dict, cJSON* json) {
+                                 dictionary_t* parsed_dict, cJSON* json,
+                                 size_t *const decompressed_size) {
 
     istream_t in = IO_make_istream(src, src_len);
     ostream_t out = IO_make_ostream(dst, dst_len);
@@ -405,7 +439,8 @@ size_t ZSTD_decompress_with_dict(void *const dst, const size_t dst_len,
     /* this decoder assumes decompression of a single frame */
     decode_frame(&out, &in, parsed_dict, json);
 
-    // return (size_t)(out.ptr - (u8 *)dst);
+    if (decompressed_size)
+        *decompressed_size = (size_t)(out.ptr - (u8 *)dst);
     return (size_t)(src_len - in.len);
 }
 
@@ -487,6 +522,8 @@ static void free_frame_context(frame_context_t *const context) {
     FSE_free_dtable(&context->ml_dtable);
     FSE_free_dtable(&context->of_dtable);
 
+    FSE_free_dtable(&context->hufweights_dtable);
+
     memset(context, 0, sizeof(frame_context_t));
 }
 
@@ -593,6 +630,7 @@ static void decompress_data(frame_context_t *const ctx, ostream_t *const out,
     // operations."
     int last_block = 0;
     int fist_block_offset = in->len;
+    const size_t first_block_out_len = out->len;
 
     cJSON* blocks_json = cJSON_AddArrayToObject(json, "ZSTD_BLOCK");
     do {
@@ -612,6 +650,18 @@ static void decompress_data(frame_context_t *const ctx, ostream_t *const out,
         const int block_type = (int)IO_read_bits(in, 2);
         const size_t block_len = IO_read_bits(in, 21);
 
+        // --index: one compact entry per block, recorded before the block
+        // body is decoded so a later run can seek straight to it
+        if (block_index_json != NULL) {
+            cJSON* index_entry_json = cJSON_CreateObject();
+            cJSON_AddNumberToObject(index_entry_json, "type", block_type);
+            cJSON_AddNumberToObject(index_entry_json, "last", last_block);
+            cJSON_AddNumberToObject(index_entry_json, "in_byte_offset", fist_block_offset - current_block_offset);
+            cJSON_AddNumberToObject(index_entry_json, "out_byte_offset", first_block_out_len - out->len);
+            cJSON_AddNumberToObject(index_entry_json, "block_length", block_len);
+            cJSON_AddItemToArray(block_index_json, index_entry_json);
+        }
+
         cJSON* last_block_json = cJSON_AddObjectToObject(block_json, "last block");
         cJSON_AddNumberToObject(last_block_json, "bit_size", 1);
         cJSON_AddNumberToObject(last_block_json, "value", last_block);
@@ -742,8 +792,10 @@ static size_t decode_literals_compressed(frame_context_t *const ctx,
                                          const int block_type,
                                          const int size_format,
                                          cJSON *json);
-static void decode_huf_table(HUF_dtable *const dtable, istream_t *const in, cJSON *json);
-static void fse_decode_hufweights(ostream_t *weights, istream_t *const in,
+static void decode_huf_table(HUF_dtable *const dtable, FSE_dtable *const scratch,
+                             istream_t *const in, cJSON *json);
+static void fse_decode_hufweights(ostream_t *weights, FSE_dtable *const scratch,
+                                    istream_t *const in,
                                     int *const num_symbs, cJSON *json);
 
 static size_t decode_literals(frame_context_t *const ctx, istream_t *const in,
@@ -950,8 +1002,9 @@ static size_t decode_literals_compressed(frame_context_t *const ctx,
         // "This section is only present when Literals_Block_Type type is
         // Compressed_Literals_Block (2)."
 
-        HUF_free_dtable(&ctx->literals_dtable);
-        decode_huf_table(&ctx->literals_dtable, &huf_stream, json);
+        // The table storage is reused in place by the rebuild, so no free
+        decode_huf_table(&ctx->literals_dtable, &ctx->hufweights_dtable,
+                         &huf_stream, json);
     } else {
         // If the previous Huffman table is being repeated, ensure it exists
         if (!ctx->literals_dtable.symbols) {
@@ -973,8 +1026,11 @@ static size_t decode_literals_compressed(frame_context_t *const ctx,
     return regenerated_size;
 }
 
-// Decode the Huffman table description
-static void decode_huf_table(HUF_dtable *const dtable, istream_t *const in, cJSON *json) {
+// Decode the Huffman table description.  `scratch` is the caller's reusable
+// FSE table for the compressed weights, so hot decode paths can hand in
+// preallocated storage (frames keep one in their context)
+static void decode_huf_table(HUF_dtable *const dtable, FSE_dtable *const scratch,
+                             istream_t *const in, cJSON *json) {
     // "All literal values from zero (included) to last present one (excluded)
     // are represented by Weight with values from 0 to Max_Number_of_Bits."
 
@@ -1024,28 +1080,26 @@ static void decode_huf_table(HUF_dtable *const dtable, istream_t *const in, cJSO
         // table
         istream_t fse_stream = IO_make_sub_istream(in, header);
         ostream_t weight_stream = IO_make_ostream(weights, HUF_MAX_SYMBS);
-        fse_decode_hufweights(&weight_stream, &fse_stream, &num_symbs, json);
+        fse_decode_hufweights(&weight_stream, scratch, &fse_stream, &num_symbs,
+                              json);
     }
 
     // Construct the table using the decoded weights
     HUF_init_dtable_usingweights(dtable, weights, num_symbs);
 }
 
-static void fse_decode_hufweights(ostream_t *weights, istream_t *const in,
+static void fse_decode_hufweights(ostream_t *weights, FSE_dtable *const scratch,
+                                    istream_t *const in,
                                     int *const num_symbs, cJSON *json) {
     const int MAX_ACCURACY_LOG = 7;
 
-    FSE_dtable dtable;
-
     // "An FSE bitstream starts by a header, describing probabilities
     // distribution. It will create a Decoding Table. For a list of Huffman
     // weights, maximum accuracy is 7 bits."
-    FSE_decode_header(&dtable, in, MAX_ACCURACY_LOG, json);
+    FSE_decode_header(scratch, in, MAX_ACCURACY_LOG, json);
 
     // Decode the weights
-    *num_symbs = FSE_decompress_interleaved2(&dtable, weights, in);
-
-    FSE_free_dtable(&dtable);
+    *num_symbs = FSE_decompress_interleaved2(scratch, weights, in);
 }
 /******* END LITERALS DECODING ************************************************/
 
@@ -1381,10 +1435,8 @@ static void decode_seq_table(FSE_dtable *const table, istream_t *const in,
 
     const size_t max_accuracies[] = {9, 8, 9};
 
-    if (mode != seq_repeat) {
-        // Free old one before overwriting
-        FSE_free_dtable(table);
-    }
+    // No free before overwriting: the init functions rebuild into the
+    // table's reserved storage in place
 
     switch (mode) {
     case seq_predefined: {
@@ -1432,6 +1484,7 @@ static void execute_sequences(frame_context_t *const ctx, ostream_t *const out,
                               const size_t literals_len,
                               const sequence_command_t *const sequences,
                               const size_t num_sequences) {
+    const double stats_t0 = stats_enable ? stats_now() : 0;
     istream_t litstream = IO_make_istream(literals, literals_len);
 
     u64 *const offset_hist = ctx->previous_offsets;
@@ -1461,6 +1514,10 @@ static void execute_sequences(frame_context_t *const ctx, ostream_t *const out,
     }
 
     ctx->current_total_output = total_output;
+
+    if (stats_enable) {
+        stats_symbol_exec_time += stats_now() - stats_t0;
+    }
 }
 
 static u32 copy_literals(const size_t literal_length, istream_t *litstream,
@@ -1556,6 +1613,20 @@ static void execute_match_copy(frame_context_t *const ctx, size_t offset,
         CORRUPTION();
     }
 
+    // When the offset is at least 16 the source and destination of a
+    // 16-byte chunk can't overlap, so the match can be copied in wide
+    // chunks the compiler lowers to vector loads/stores; the tail is
+    // shorter than the offset so a plain memcpy is safe for it too
+    if (offset >= 16) {
+        size_t j = 0;
+        while (j + 16 <= match_length) {
+            memcpy(write_ptr + j, write_ptr + j - offset, 16);
+            j += 16;
+        }
+        memcpy(write_ptr + j, write_ptr + j - offset, match_length - j);
+        return;
+    }
+
     // We must copy byte by byte because the match length might be larger
     // than the offset
     // ex: if the output so far was "abc", a command with offset=3 and
@@ -1595,6 +1666,57 @@ size_t ZSTD_get_decompressed_size(const void *src, const size_t src_len) {
         }
     }
 }
+size_t ZSTD_get_frame_compressed_size(const void *src, const size_t src_len) {
+    istream_t in = IO_make_istream(src, src_len);
+
+    const u32 magic_number = (u32)IO_read_bits(&in, 32);
+
+    if ((magic_number & 0xFFFFFFF0U) == 0x184D2A50U) {
+        // skippable frame: magic, frame size, then frame size bytes of data
+        const u32 frame_size = (u32)IO_read_bits(&in, 32);
+        IO_advance_input(&in, frame_size);
+        return src_len - in.len;
+    }
+
+    if (magic_number != ZSTD_MAGIC_NUMBER) {
+        ERROR("ZSTD frame magic number did not match");
+    }
+
+    // walk the block headers without decoding any block content, so frame
+    // boundaries can be found cheaply for dispatch and indexing
+    {
+        frame_header_t header;
+        int last_block = 0;
+
+        parse_frame_header(&header, &in);
+
+        do {
+            last_block = (int)IO_read_bits(&in, 1);
+            const int block_type = (int)IO_read_bits(&in, 2);
+            const size_t block_len = IO_read_bits(&in, 21);
+
+            switch (block_type) {
+            case 0:
+            case 2:
+                // raw and compressed blocks store block_len bytes
+                IO_advance_input(&in, block_len);
+                break;
+            case 1:
+                // RLE blocks store the single byte to repeat
+                IO_advance_input(&in, 1);
+                break;
+            default:
+                CORRUPTION();
+            }
+        } while (!last_block);
+
+        if (header.content_checksum_flag) {
+            IO_advance_input(&in, 4);
+        }
+    }
+
+    return src_len - in.len;
+}
 /******* END OUTPUT SIZE COUNTING *********************************************/
 
 /******* DICTIONARY PARSING ***************************************************/
@@ -1658,7 +1780,11 @@ void parse_dictionary(dictionary_t *const dict, const void *src,
     // recent offsets (instead of using {1,4,8}), stored in order, 4-bytes
     // little-endian each, for a total of 12 bytes. Each recent offset must have
     // a value < dictionary size."
-    decode_huf_table(&dict->literals_dtable, &in, 0);
+    // Dictionary parsing is one-shot, so a local scratch table is fine here
+    FSE_dtable hufweights_scratch;
+    memset(&hufweights_scratch, 0, sizeof(FSE_dtable));
+    decode_huf_table(&dict->literals_dtable, &hufweights_scratch, &in, 0);
+    FSE_free_dtable(&hufweights_scratch);
     decode_seq_table(&dict->of_dtable, &in, seq_offset, seq_fse);
     decode_seq_table(&dict->ml_dtable, &in, seq_match_length, seq_fse);
     decode_seq_table(&dict->ll_dtable, &in, seq_literal_length, seq_fse);
@@ -1711,6 +1837,8 @@ static void HUF_copy_dtable(HUF_dtable *const dst,
     if (!dst->symbols || !dst->num_bits) {
         BAD_ALLOC();
     }
+    // Sized exactly; a later rebuild grows it to worst case
+    dst->capacity_bits = src->max_bits;
 
     memcpy(dst->symbols, src->symbols, size);
     memcpy(dst->num_bits, src->num_bits, size);
@@ -1731,6 +1859,8 @@ static void FSE_copy_dtable(FSE_dtable *const dst, const FSE_dtable *const src)
     if (!dst->symbols || !dst->num_bits || !dst->new_state_base) {
         BAD_ALLOC();
     }
+    // Sized exactly; a later rebuild grows it to worst case
+    dst->capacity_log = src->accuracy_log;
 
     memcpy(dst->symbols, src->symbols, size);
     memcpy(dst->num_bits, src->num_bits, size);
@@ -1774,6 +1904,180 @@ static void frame_context_apply_dict(frame_context_t *const ctx,
     }
 }
 
+/// Digested dictionary cache: the entropy tables derived by
+/// parse_dictionary() depend only on the dictionary bytes, so they can be
+/// persisted once and reloaded in O(size) on later runs instead of being
+/// re-derived for every invocation.  The digest is a flat blob in host
+/// byte order (it is a local cache next to the dictionary, not an
+/// interchange format): a magic word, the source dictionary's size and
+/// FNV-1a hash so a changed dictionary invalidates the cache, the
+/// dictionary id and repeat offsets, the raw HUF and FSE decode tables
+/// and the content.
+
+#define DICT_DIGEST_MAGIC 0x5A444431U
+
+static u32 fnv1a_32(const u8 *const data, const size_t len) {
+    u32 hash = 2166136261U;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ data[i]) * 16777619U;
+    }
+    return hash;
+}
+
+static void save_fse_dtable(FILE *const f, const FSE_dtable *const dtable) {
+    const u32 accuracy_log = (u32)dtable->accuracy_log;
+    fwrite(&accuracy_log, sizeof(accuracy_log), 1, f);
+    if (accuracy_log) {
+        const size_t size = (size_t)1 << accuracy_log;
+        fwrite(dtable->symbols, 1, size, f);
+        fwrite(dtable->num_bits, 1, size, f);
+        fwrite(dtable->new_state_base, sizeof(u16), size, f);
+    }
+}
+
+static int load_fse_dtable(FILE *const f, FSE_dtable *const dtable) {
+    u32 accuracy_log;
+
+    memset(dtable, 0, sizeof(FSE_dtable));
+    if (fread(&accuracy_log, sizeof(accuracy_log), 1, f) != 1 ||
+        accuracy_log > FSE_MAX_ACCURACY_LOG) {
+        return 0;
+    }
+    if (accuracy_log == 0) {
+        return 1;
+    }
+
+    const size_t size = (size_t)1 << accuracy_log;
+    dtable->accuracy_log = (int)accuracy_log;
+    dtable->symbols = malloc(size);
+    dtable->num_bits = malloc(size);
+    dtable->new_state_base = malloc(size * sizeof(u16));
+    if (!dtable->symbols || !dtable->num_bits || !dtable->new_state_base) {
+        BAD_ALLOC();
+    }
+    // Sized exactly; a later rebuild grows it to worst case
+    dtable->capacity_log = (int)accuracy_log;
+    return fread(dtable->symbols, 1, size, f) == size &&
+           fread(dtable->num_bits, 1, size, f) == size &&
+           fread(dtable->new_state_base, sizeof(u16), size, f) == size;
+}
+
+int save_dictionary_digest(const dictionary_t *const dict, const void *src,
+                           size_t src_len, const char *file_name) {
+    FILE *const f = fopen(file_name, "wb");
+    u32 header[4];
+    u64 content_size;
+
+    if (!f) {
+        return 0;
+    }
+
+    header[0] = DICT_DIGEST_MAGIC;
+    header[1] = (u32)src_len;
+    header[2] = fnv1a_32(src, src_len);
+    header[3] = dict->dictionary_id;
+    fwrite(header, sizeof(header), 1, f);
+    fwrite(dict->previous_offsets, sizeof(dict->previous_offsets), 1, f);
+
+    const u32 max_bits = (u32)dict->literals_dtable.max_bits;
+    fwrite(&max_bits, sizeof(max_bits), 1, f);
+    if (max_bits) {
+        const size_t size = (size_t)1 << max_bits;
+        fwrite(dict->literals_dtable.symbols, 1, size, f);
+        fwrite(dict->literals_dtable.num_bits, 1, size, f);
+    }
+
+    // same order parse_dictionary() derives them in
+    save_fse_dtable(f, &dict->of_dtable);
+    save_fse_dtable(f, &dict->ml_dtable);
+    save_fse_dtable(f, &dict->ll_dtable);
+
+    content_size = dict->content_size;
+    fwrite(&content_size, sizeof(content_size), 1, f);
+    fwrite(dict->content, 1, dict->content_size, f);
+
+    fclose(f);
+    return 1;
+}
+
+int load_dictionary_digest(dictionary_t *const dict, const void *src,
+                           size_t src_len, const char *file_name) {
+    FILE *const f = fopen(file_name, "rb");
+    u32 header[4];
+    u32 max_bits;
+    u64 content_size;
+
+    if (!f) {
+        return 0;
+    }
+    memset(dict, 0, sizeof(dictionary_t));
+
+    if (fread(header, sizeof(header), 1, f) != 1 ||
+        header[0] != DICT_DIGEST_MAGIC || header[1] != (u32)src_len ||
+        header[2] != fnv1a_32(src, src_len)) {
+        fclose(f);
+        return 0;
+    }
+    dict->dictionary_id = header[3];
+
+    if (fread(dict->previous_offsets, sizeof(dict->previous_offsets), 1,
+              f) != 1 ||
+        fread(&max_bits, sizeof(max_bits), 1, f) != 1 ||
+        max_bits > HUF_MAX_BITS) {
+        goto corrupt;
+    }
+    if (max_bits) {
+        const size_t size = (size_t)1 << max_bits;
+        dict->literals_dtable.max_bits = (int)max_bits;
+        dict->literals_dtable.symbols = malloc(size);
+        dict->literals_dtable.num_bits = malloc(size);
+        if (!dict->literals_dtable.symbols ||
+            !dict->literals_dtable.num_bits) {
+            BAD_ALLOC();
+        }
+        // Sized exactly; a later rebuild grows it to worst case
+        dict->literals_dtable.capacity_bits = (int)max_bits;
+        if (fread(dict->literals_dtable.symbols, 1, size, f) != size ||
+            fread(dict->literals_dtable.num_bits, 1, size, f) != size) {
+            goto corrupt;
+        }
+    }
+
+    if (!load_fse_dtable(f, &dict->of_dtable) ||
+        !load_fse_dtable(f, &dict->ml_dtable) ||
+        !load_fse_dtable(f, &dict->ll_dtable)) {
+        goto corrupt;
+    }
+
+    if (fread(&content_size, sizeof(content_size), 1, f) != 1 ||
+        content_size > src_len) {
+        goto corrupt;
+    }
+    dict->content_size = content_size;
+    dict->content = malloc(dict->content_size);
+    if (!dict->content) {
+        BAD_ALLOC();
+    }
+    if (fread(dict->content, 1, dict->content_size, f) !=
+        dict->content_size) {
+        goto corrupt;
+    }
+
+    fclose(f);
+    return 1;
+
+corrupt:
+    // a truncated or stale digest falls back to a normal parse
+    fclose(f);
+    HUF_free_dtable(&dict->literals_dtable);
+    FSE_free_dtable(&dict->of_dtable);
+    FSE_free_dtable(&dict->ml_dtable);
+    FSE_free_dtable(&dict->ll_dtable);
+    free(dict->content);
+    memset(dict, 0, sizeof(dictionary_t));
+    return 0;
+}
+
 #else  // ZDEC_NO_DICTIONARY is defined
 
 static void frame_context_apply_dict(frame_context_t *const ctx,
@@ -1782,6 +2086,24 @@ static void frame_context_apply_dict(frame_context_t *const ctx,
     if (dict && dict->content) ERROR("dictionary not supported");
 }
 
+int save_dictionary_digest(const dictionary_t *const dict, const void *src,
+                           size_t src_len, const char *file_name) {
+    (void)dict;
+    (void)src;
+    (void)src_len;
+    (void)file_name;
+    return 0;
+}
+
+int load_dictionary_digest(dictionary_t *const dict, const void *src,
+                           size_t src_len, const char *file_name) {
+    (void)dict;
+    (void)src;
+    (void)src_len;
+    (void)file_name;
+    return 0;
+}
+
 #endif
 /******* END DICTIONARY PARSING ***********************************************/
 
@@ -1933,6 +2255,26 @@ static inline u64 read_bits_LE(const u8 *src, const int num_bits,
     size_t bit_offset = offset % 8;
     u64 res = 0;
 
+    // Fast path: gather the in-range bytes with one unrolled expression
+    // instead of the shift-and-mask loop.  Touches exactly the bytes the
+    // loop below would, so it is safe at the end of the stream
+    if (num_bits <= 63 && num_bits + (int)bit_offset <= 64) {
+        int bytes = (num_bits + (int)bit_offset + 7) / 8;
+        u64 chunk = 0;
+        switch (bytes) {
+            case 8: chunk |= (u64)src[7] << 56; /* fall through */
+            case 7: chunk |= (u64)src[6] << 48; /* fall through */
+            case 6: chunk |= (u64)src[5] << 40; /* fall through */
+            case 5: chunk |= (u64)src[4] << 32; /* fall through */
+            case 4: chunk |= (u64)src[3] << 24; /* fall through */
+            case 3: chunk |= (u64)src[2] << 16; /* fall through */
+            case 2: chunk |= (u64)src[1] << 8;  /* fall through */
+            case 1: chunk |= (u64)src[0];       /* fall through */
+            default: break;
+        }
+        return (chunk >> bit_offset) & (((u64)1 << num_bits) - 1);
+    }
+
     int shift = 0;
     int left = num_bits;
     while (left > 0) {
@@ -1954,6 +2296,10 @@ static inline u64 read_bits_LE(const u8 *src, const int num_bits,
 /// bottom are filled in with `0` bits instead of reading from before `src`.
 static inline u64 STREAM_read_bits(const u8 *const src, const int bits,
                                    i64 *const offset) {
+    if (stats_enable) {
+        stats_bit_reader_calls++;
+        stats_bit_reader_bits += bits;
+    }
     *offset = *offset - bits;
     size_t actual_off = *offset;
     size_t actual_bits = bits;
@@ -2094,7 +2440,7 @@ static size_t HUF_decompress_4stream(const HUF_dtable *const dtable,
 /// earlier codes)
 static void HUF_init_dtable(HUF_dtable *const table, const u8 *const bits,
                             const int num_symbs) {
-    memset(table, 0, sizeof(HUF_dtable));
+    const double stats_t0 = stats_enable ? stats_now() : 0;
     if (num_symbs > HUF_MAX_SYMBS) {
         ERROR("Too many symbols for Huffman");
     }
@@ -2114,15 +2460,10 @@ static void HUF_init_dtable(HUF_dtable *const table, const u8 *const bits,
     }
 
     const size_t table_size = 1 << max_bits;
+    // Rebuilds overwrite the reserved storage in place, so blocks that
+    // retransmit a table don't pay malloc/free on the decode hot path
+    HUF_reserve_dtable(table);
     table->max_bits = max_bits;
-    table->symbols = malloc(table_size);
-    table->num_bits = malloc(table_size);
-
-    if (!table->symbols || !table->num_bits) {
-        free(table->symbols);
-        free(table->num_bits);
-        BAD_ALLOC();
-    }
 
     // "Symbols are sorted by Weight. Within same Weight, symbols keep natural
     // order. Symbols with a Weight of zero are removed. Then, starting from
@@ -2154,6 +2495,10 @@ static void HUF_init_dtable(HUF_dtable *const table, const u8 *const bits,
             rank_idx[bits[i]] += len;
         }
     }
+
+    if (stats_enable) {
+        stats_table_build_time += stats_now() - stats_t0;
+    }
 }
 
 static void HUF_init_dtable_usingweights(HUF_dtable *const table,
@@ -2197,6 +2542,27 @@ static void HUF_init_dtable_usingweights(HUF_dtable *const table,
     HUF_init_dtable(table, bits, num_symbs + 1);
 }
 
+static void HUF_reserve_dtable(HUF_dtable *const dtable) {
+    if (dtable->capacity_bits >= HUF_MAX_BITS) {
+        return;
+    }
+
+    // Tables copied from a dictionary are sized exactly; replace them with
+    // worst-case storage the first time the frame rebuilds them
+    free(dtable->symbols);
+    free(dtable->num_bits);
+
+    const size_t table_size = (size_t)1 << HUF_MAX_BITS;
+    dtable->symbols = malloc(table_size);
+    dtable->num_bits = malloc(table_size);
+    if (!dtable->symbols || !dtable->num_bits) {
+        free(dtable->symbols);
+        free(dtable->num_bits);
+        BAD_ALLOC();
+    }
+    dtable->capacity_bits = HUF_MAX_BITS;
+}
+
 static void HUF_free_dtable(HUF_dtable *const dtable) {
     free(dtable->symbols);
     free(dtable->num_bits);
@@ -2305,6 +2671,7 @@ static size_t FSE_decompress_interleaved2(const FSE_dtable *const dtable,
 static void FSE_init_dtable(FSE_dtable *const dtable,
                             const i16 *const norm_freqs, const int num_symbs,
                             const int accuracy_log) {
+    const double stats_t0 = stats_enable ? stats_now() : 0;
     if (accuracy_log > FSE_MAX_ACCURACY_LOG) {
         ERROR("FSE accuracy too large");
     }
@@ -2312,16 +2679,12 @@ static void FSE_init_dtable(FSE_dtable *const dtable,
         ERROR("Too many symbols for FSE");
     }
 
+    // Rebuilds overwrite the reserved storage in place, so blocks that
+    // retransmit a table don't pay malloc/free on the decode hot path
+    FSE_reserve_dtable(dtable);
     dtable->accuracy_log = accuracy_log;
 
     const size_t size = (size_t)1 << accuracy_log;
-    dtable->symbols = malloc(size * sizeof(u8));
-    dtable->num_bits = malloc(size * sizeof(u8));
-    dtable->new_state_base = malloc(size * sizeof(u16));
-
-    if (!dtable->symbols || !dtable->num_bits || !dtable->new_state_base) {
-        BAD_ALLOC();
-    }
 
     // Used to determine how many bits need to be read for each state,
     // and where the destination range should start
@@ -2386,6 +2749,10 @@ static void FSE_init_dtable(FSE_dtable *const dtable,
         dtable->new_state_base[i] =
             ((u16)next_state_desc << dtable->num_bits[i]) - size;
     }
+
+    if (stats_enable) {
+        stats_table_build_time += stats_now() - stats_t0;
+    }
 }
 
 /// Decode an FSE header as defined in the Zstandard format specification and
@@ -2499,13 +2866,7 @@ static void FSE_decode_header(FSE_dtable *const dtable, istream_t *const in,
 }
 
 static void FSE_init_dtable_rle(FSE_dtable *const dtable, const u8 symb) {
-    dtable->symbols = malloc(sizeof(u8));
-    dtable->num_bits = malloc(sizeof(u8));
-    dtable->new_state_base = malloc(sizeof(u16));
-
-    if (!dtable->symbols || !dtable->num_bits || !dtable->new_state_base) {
-        BAD_ALLOC();
-    }
+    FSE_reserve_dtable(dtable);
 
     // This setup will always have a state of 0, always return symbol `symb`,
     // and never consume any bits
@@ -2515,6 +2876,27 @@ static void FSE_init_dtable_rle(FSE_dtable *const dtable, const u8 symb) {
     dtable->accuracy_log = 0;
 }
 
+static void FSE_reserve_dtable(FSE_dtable *const dtable) {
+    if (dtable->capacity_log >= FSE_MAX_ACCURACY_LOG) {
+        return;
+    }
+
+    // Tables copied from a dictionary or loaded from a digest are sized
+    // exactly; replace them with worst-case storage on the first rebuild
+    free(dtable->symbols);
+    free(dtable->num_bits);
+    free(dtable->new_state_base);
+
+    const size_t size = (size_t)1 << FSE_MAX_ACCURACY_LOG;
+    dtable->symbols = malloc(size * sizeof(u8));
+    dtable->num_bits = malloc(size * sizeof(u8));
+    dtable->new_state_base = malloc(size * sizeof(u16));
+    if (!dtable->symbols || !dtable->num_bits || !dtable->new_state_base) {
+        BAD_ALLOC();
+    }
+    dtable->capacity_log = FSE_MAX_ACCURACY_LOG;
+}
+
 static void FSE_free_dtable(FSE_dtable *const dtable) {
     free(dtable->symbols);
     free(dtable->num_bits);
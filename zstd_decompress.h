@@ -9,6 +9,7 @@
  */
 
 #include <stddef.h>   /* size_t */
+#include <setjmp.h>   /* jmp_buf */
 #include "utils.h"
 
 // If the data doesn't have decompressed size with it, fallback on assuming the
@@ -21,6 +22,13 @@
 // Error message then exit
 #define ERR_OUT(...) { fprintf(stderr, __VA_ARGS__); exit(1); }
 
+/// Recovery point for --tolerant: a caller arms zdec_recover_armed after a
+/// setjmp on zdec_recover_env, and decode errors then longjmp back with the
+/// message in zdec_error_msg instead of exiting the process
+extern jmp_buf zdec_recover_env;
+extern unsigned char zdec_recover_armed;
+extern const char *zdec_error_msg;
+
 typedef unsigned char u8;
 
 /******* EXPOSED TYPES ********************************************************/
@@ -39,15 +47,23 @@ size_t ZSTD_decompress(void *const dst, const size_t dst_len,
 
 /// If `dict != NULL` and `dict_len >= 8`, does the same thing as
 /// `ZSTD_decompress` but uses the provided dict
+/// If `decompressed_size != NULL`, it receives the number of bytes written
+/// to `dst`
 size_t ZSTD_decompress_with_dict(void *const dst, const size_t dst_len,
                               const void *const src, const size_t src_len,
-                              dictionary_t* parsed_dict, cJSON* json);
+                              dictionary_t* parsed_dict, cJSON* json,
+                              size_t *const decompressed_size);
 
 /// Get the decompressed size of an input stream so memory can be allocated in
 /// advance
 /// Returns -1 if the size can't be determined
 /// Assumes decompression of a single frame
 size_t ZSTD_get_decompressed_size(const void *const src, const size_t src_len);
+
+/// Get the compressed size of the frame starting at `src` by walking its
+/// block headers without decoding block content.  Handles skippable frames.
+/// Useful to find frame boundaries in multi-frame inputs
+size_t ZSTD_get_frame_compressed_size(const void *const src, const size_t src_len);
 /******* END DECOMPRESSION FUNCTIONS ******************************************/
 
 /******* DICTIONARY MANAGEMENT ***********************************************/
@@ -67,6 +83,24 @@ dictionary_t* create_dictionary(void);
 void parse_dictionary(dictionary_t *const dict, const void *src,
                              size_t src_len);
 
+/*
+ * Persist the digested dictionary (entropy tables, repeat offsets and
+ * content) to file_name so later runs can skip re-deriving the tables;
+ * src/src_len are the raw dictionary bytes, recorded so a changed
+ * dictionary invalidates the cache.  Returns 1 on success.
+ */
+int save_dictionary_digest(const dictionary_t *const dict, const void *src,
+                           size_t src_len, const char *file_name);
+
+/*
+ * Load a digested dictionary written by save_dictionary_digest() in
+ * O(size), verifying it matches the raw dictionary bytes in src/src_len.
+ * Returns 1 on success; on any mismatch or truncation the dictionary is
+ * left empty and the caller should fall back to parse_dictionary().
+ */
+int load_dictionary_digest(dictionary_t *const dict, const void *src,
+                           size_t src_len, const char *file_name);
+
 /*
  * Free internal Huffman tables, FSE tables, and dictionary content
  */
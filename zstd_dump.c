@@ -29,19 +29,36 @@
 #  define SET_BINARY_MODE(file)
 #endif
 
-#define local static
+#if !defined(_WIN32) && !defined(WIN32)
+#  include <pthread.h>
+#  define HAVE_FRAME_WORKERS 1
+#endif
 
-unsigned char contentChecksum_g;
+#define local static
 
 typedef struct {
     u8* address;
     size_t size;
+    int mapped;
 } buffer_s;
 
-static void freeBuffer(buffer_s b) { free(b.address); }
+static void freeBuffer(buffer_s b)
+{
+    if (b.mapped)
+        unmap_file(b.address, b.size);
+    else
+        free(b.address);
+}
 
 static buffer_s read_file(const char *path)
 {
+    size_t maplen = 0;
+    void* const mapped = map_file(path, &maplen);
+    if (mapped) {
+        buffer_s const m = { mapped, maplen, 1 };
+        return m;
+    }
+
     FILE* const f = fopen(path, "rb");
     if (!f) ERR_OUT("failed to open file %s \n", path);
 
@@ -56,7 +73,7 @@ static buffer_s read_file(const char *path)
     if (read != size) ERR_OUT("error while reading file %s \n", path);
 
     fclose(f);
-    buffer_s const b = { ptr, size };
+    buffer_s const b = { ptr, size, 0 };
     return b;
 }
 
@@ -83,7 +100,6 @@ local unsigned decode_zstd_header(const unsigned char *source, cJSON* json)
     unused_bit = (flags >> 4) & 0x1;
     single_segment_flag = (flags >> 5) & 0x1;
     frame_content_size_flag = (flags >> 6) & 0x3;
-    contentChecksum_g = c_checksum_flag;
     cJSON* frame_header_json = cJSON_AddObjectToObject(json, "FRAME HEADER");
     cJSON* frame_header_descriptor_json = cJSON_AddObjectToObject(frame_header_json, "FRAME HEADER DESCRIPTOR");
     
@@ -229,11 +245,28 @@ local unsigned decode_zstd_header(const unsigned char *source, cJSON* json)
 int zstd_dump(void *const dst, const size_t dst_len,
               const void *const src, const size_t src_len,
               dictionary_t* parsed_dict,
-              cJSON* json)
+              cJSON* json, size_t *const decompressed_size)
 {
     int ret = 0;
     unsigned zstd_header_size;
-    unsigned zstd_blocks_size;
+    unsigned checksum_flag;
+    unsigned int magic_number = *(unsigned int*)src;
+
+    if (decompressed_size)
+        *decompressed_size = 0;
+
+    if ((magic_number & 0xFFFFFFF0U) == 0x184D2A50U) {
+        /* skippable frame: record magic and size, no content to decode */
+        cJSON* skippable_json = cJSON_AddObjectToObject(json, "SKIPPABLE_FRAME");
+        cJSON* magic_number_json = cJSON_AddObjectToObject(skippable_json, "MAGIC NUMBER");
+        cJSON_AddNumberToObject(magic_number_json, "bit_size", 32);
+        dump_data_to_json(magic_number_json, "value", (unsigned char*)src, 4);
+
+        cJSON* frame_size_json = cJSON_AddObjectToObject(skippable_json, "FRAME SIZE");
+        cJSON_AddNumberToObject(frame_size_json, "bit_size", 32);
+        cJSON_AddNumberToObject(frame_size_json, "value", *(unsigned int*)((unsigned char*)src + 4));
+        return 0;
+    }
 
     cJSON* zstd_format_json = cJSON_AddObjectToObject(json, "ZSTD_FORMAT");
     cJSON* zstd_header_json = cJSON_AddObjectToObject(zstd_format_json, "ZSTD_HEADER");
@@ -243,12 +276,17 @@ int zstd_dump(void *const dst, const size_t dst_len,
         return -1;
     }
 
+    /* read the checksum flag from the descriptor byte directly so frames can
+       be dumped concurrently without sharing contentChecksum_g */
+    checksum_flag = (((unsigned char*)src)[4] >> 2) & 0x1;
+
     size_t const src_offset =
         ZSTD_decompress_with_dict(dst, dst_len,
                                   src, src_len,
-                                  parsed_dict, zstd_format_json);
+                                  parsed_dict, zstd_format_json,
+                                  decompressed_size);
 
-    if (contentChecksum_g) {
+    if (checksum_flag) {
         cJSON* content_checksum_json = cJSON_AddObjectToObject(zstd_format_json, "Content Checksum");
         cJSON_AddNumberToObject(content_checksum_json, "bit_size", 32);
         dump_data_to_json(content_checksum_json, "value", (unsigned char*)src + src_offset, 4);
@@ -257,112 +295,593 @@ int zstd_dump(void *const dst, const size_t dst_len,
     return ret;
 }
 
-int main(int argc, char **argv)
+
+/* State sidecar for --incr: magic, verified prefix length, frame count
+   and a probe hash, host endian, so the next run over an append-only log
+   can skip everything it already dumped */
+#define INCR_STATE_MAGIC 0x31524349U   /* "ICR1" */
+
+/* FNV-1a over a probe window at each end of the prefix -- enough to catch
+   a rewritten or truncated log without rereading gigabytes */
+local unsigned int incr_probe_hash(const unsigned char *source, size_t prefix_len)
 {
-    int ret, put = 0, i, wr_file = 0;
+    unsigned int hash = 2166136261U;
+    size_t probe = prefix_len < 4096 ? prefix_len : 4096;
+    size_t i;
+
+    for (i = 0; i < probe; i++) {
+        hash ^= source[i];
+        hash *= 16777619U;
+    }
+    for (i = prefix_len - probe; i < prefix_len; i++) {
+        hash ^= source[i];
+        hash *= 16777619U;
+    }
+    return hash;
+}
+
+local int save_incr_state(const char *file_name, const unsigned char *source,
+                          size_t prefix_len, int num_frames)
+{
+    unsigned int magic = INCR_STATE_MAGIC;
+    unsigned long long length = prefix_len;
+    unsigned int count = num_frames;
+    unsigned int hash = incr_probe_hash(source, prefix_len);
+    FILE *state = fopen(file_name, "wb");
+
+    if (state == NULL)
+        return 0;
+    if (fwrite(&magic, sizeof(magic), 1, state) != 1 ||
+        fwrite(&length, sizeof(length), 1, state) != 1 ||
+        fwrite(&count, sizeof(count), 1, state) != 1 ||
+        fwrite(&hash, sizeof(hash), 1, state) != 1) {
+        fclose(state);
+        remove(file_name);
+        return 0;
+    }
+    fclose(state);
+    return 1;
+}
+
+/* Load the previous run's state and verify it against the current file.
+   Returns the verified prefix length, or 0 when the state is missing,
+   stale or does not match, in which case a full dump is done. */
+local size_t load_incr_state(const char *file_name, const unsigned char *source,
+                             size_t len)
+{
+    unsigned int magic, count, hash;
+    unsigned long long length;
+    FILE *state = fopen(file_name, "rb");
+
+    if (state == NULL)
+        return 0;
+    if (fread(&magic, sizeof(magic), 1, state) != 1 ||
+        magic != INCR_STATE_MAGIC ||
+        fread(&length, sizeof(length), 1, state) != 1 ||
+        length == 0 || length > len ||
+        fread(&count, sizeof(count), 1, state) != 1 ||
+        fread(&hash, sizeof(hash), 1, state) != 1 ||
+        hash != incr_probe_hash(source, (size_t)length)) {
+        fclose(state);
+        return 0;
+    }
+    fclose(state);
+    return (size_t)length;
+}
+
+/* One independent frame of a multi-frame input, with its input slice,
+   output slice and private JSON sub-tree so frames can be decoded on
+   worker threads and merged in order afterwards */
+typedef struct {
+    size_t offset;
+    size_t csize;
+    size_t dsize;
+    u8 *dst;
+    size_t dst_len;
+    const u8 *src;
+    dictionary_t *dict;
+    cJSON *json;
+    size_t decompressed;
+    int in_range;
+    int ret;
+} frame_job_s;
+
+#ifdef HAVE_FRAME_WORKERS
+typedef struct {
+    frame_job_s *jobs;
+    int num_jobs;
+    int next_job;
+    pthread_mutex_t lock;
+} frame_pool_s;
+
+static void *frame_worker(void *arg)
+{
+    frame_pool_s *const pool = arg;
+    int job_index;
+
+    for (;;) {
+        pthread_mutex_lock(&pool->lock);
+        job_index = pool->next_job++;
+        pthread_mutex_unlock(&pool->lock);
+        if (job_index >= pool->num_jobs)
+            return NULL;
+
+        frame_job_s *const job = &pool->jobs[job_index];
+        job->ret = zstd_dump(job->dst, job->dst_len, job->src, job->csize,
+                             job->dict, job->json, &job->decompressed);
+    }
+}
+#endif
+
+/* Dump one input file; in batch mode this is called once per listed name so
+   the parsed dictionary and process startup are paid for only once. */
+local int dump_file(const char *name, dictionary_t *const parsed_dict, int incremental,
+                    int put, int wr_file, int num_threads)
+{
+    int ret = 0, i;
+    int num_frames = 0, sizes_known = 1;
     unsigned file_name_len = 0;
-    char *arg, *name = NULL, *dic_name = NULL;
-    size_t len = 0;
+    size_t scan_offset, total_written = 0;
+    frame_job_s *frames = NULL;
     char compressed_log_file_name[250] = {0};
     char decompressed_log_file_name[250] = {0};
     char decompressed_file_name[250] = {0};
+    char stream_log_file_name[250] = {0};
+    char binary_sidecar_file_name[250] = {0};
+    char stats_log_file_name[250] = {0};
+    char block_index_file_name[250] = {0};
+    char incr_state_file_name[250] = {0};
+    FILE *stream_file = NULL;
+    cJSON *index_root_json = NULL;
+    int incr_ranged = 0;
 
-    /* process arguments */
-    while (arg = *++argv, --argc)
-        if (arg[0] == '-') {
-            if (arg[1] == 'w' && arg[2] == 0)
-                put = 1, wr_file = 1;
-            else if (arg[1] == 'v' && arg[2] == 0)
-                put = 1, print_data_verbose = 1;
-            else {
-                fprintf(stderr, "invalid option %s\n", arg);
-                return 3;
-            }
-        }
-        else if (name != NULL) {
-            if (dic_name != NULL) {
-                fprintf(stderr, "only one or two files name allowed\n");
-                return 3;
-            }
-            else {
-                dic_name = arg;
-            }
-        }
-        else
-            name = arg;
-    
     buffer_s const input = read_file(name);
 
-    buffer_s dict = { NULL, 0 };
-    if (dic_name) {
-        dict = read_file(dic_name);
-    }
-
     file_name_len = strlen(name);
     if (file_name_len < 200) {
         strcpy(compressed_log_file_name, name);
         strcpy(decompressed_log_file_name, name);
         strcpy(decompressed_file_name, name);
-        strcat (compressed_log_file_name, "_compressed.json");
-        strcat (decompressed_log_file_name, "_decompressed.json");
+        strcpy(stream_log_file_name, name);
+        strcpy(binary_sidecar_file_name, name);
+        strcpy(stats_log_file_name, name);
+        strcpy(block_index_file_name, name);
+        strcpy(incr_state_file_name, name);
+        strcat (compressed_log_file_name, binary_format_enable ?
+                "_compressed.cfb" : "_compressed.json");
+        strcat (decompressed_log_file_name, binary_format_enable ?
+                "_decompressed.cfb" : "_decompressed.json");
         strcat (decompressed_file_name, "_decompressed.bin");
+        strcat (stream_log_file_name, "_stream.json");
+        strcat (binary_sidecar_file_name, "_data.bin");
+        strcat (stats_log_file_name, "_stats.json");
+        strcat (block_index_file_name, binary_format_enable ?
+                "_index.cfb" : "_index.json");
+        strcat (incr_state_file_name, "_incr.bin");
     } else {
-        strcat (compressed_log_file_name, "zstd_compressed.json");
-        strcat (decompressed_log_file_name, "zstd_decompressed.json");
+        strcat (compressed_log_file_name, binary_format_enable ?
+                "zstd_compressed.cfb" : "zstd_compressed.json");
+        strcat (decompressed_log_file_name, binary_format_enable ?
+                "zstd_decompressed.cfb" : "zstd_decompressed.json");
         strcat (decompressed_file_name, "zstd_decompressed.bin");
+        strcat (stream_log_file_name, "zstd_stream.json");
+        strcat (binary_sidecar_file_name, "zstd_data.bin");
+        strcat (stats_log_file_name, "zstd_stats.json");
+        strcat (block_index_file_name, binary_format_enable ?
+                "zstd_index.cfb" : "zstd_index.json");
+        strcat (incr_state_file_name, "zstd_incr.bin");
+    }
+
+    if (json_stream_enable) {
+        stream_file = fopen(stream_log_file_name, "w");
+        jw_begin_document(stream_file);
+    }
+
+    if (binary_sidecar_enable) {
+        binary_sidecar_file = fopen(binary_sidecar_file_name, "wb");
+        output_buffer_attach(binary_sidecar_file);
+        binary_sidecar_offset = 0;
+    }
+
+    /* the arena bump allocator is not thread safe, so parallel decodes
+       keep the system allocator */
+    if (num_threads <= 1)
+        json_arena_init();
+
+    if (stats_enable) {
+        stats_reset();
+        stats_in_bytes = input.size;
     }
 
     compressed_data_log_file = fopen(compressed_log_file_name, "w");
     compressed_data_json = cJSON_CreateObject();
 
-    size_t out_capacity = ZSTD_get_decompressed_size(input.address, input.size);
-    if (out_capacity == (size_t)-1) {
-        out_capacity = MAX_COMPRESSION_RATIO * input.size;
-        fprintf(stderr, "WARNING: Compressed data does not contain "
-                        "decompressed size, going to assume the compression "
-                        "ratio is at most %d (decompressed size of at most "
-                        "%u) \n",
-                MAX_COMPRESSION_RATIO, (unsigned)out_capacity);
+    if (block_index_enable) {
+        index_root_json = cJSON_CreateObject();
+        block_index_json = cJSON_AddArrayToObject(index_root_json, "BLOCK_INDEX");
+    }
+
+    /* walk the frame headers once to find frame boundaries, so multi-frame
+       inputs can be split into independent decode jobs */
+    scan_offset = 0;
+    while (scan_offset + 4 <= input.size) {
+        size_t frame_csize;
+        if (tolerant_enable && setjmp(zdec_recover_env)) {
+            /* the header walk ran off the truncated tail; count the
+               damaged remainder as one final partial frame */
+            frame_csize = input.size - scan_offset;
+        } else {
+            zdec_recover_armed = tolerant_enable;
+            frame_csize = ZSTD_get_frame_compressed_size(input.address + scan_offset,
+                                                         input.size - scan_offset);
+        }
+        zdec_recover_armed = 0;
+        if (tolerant_enable && frame_csize > input.size - scan_offset)
+            frame_csize = input.size - scan_offset;
+        scan_offset += frame_csize;
+        num_frames++;
+    }
+    if (num_frames == 0)
+        ERR_OUT("no zstd frame found in %s \n", name);
+
+    frames = malloc(num_frames * sizeof(frame_job_s));
+    if (!frames) ERR_OUT("failed to allocate memory \n");
+
+    size_t out_capacity = 0;
+    scan_offset = 0;
+    for (i = 0; i < num_frames; i++) {
+        frames[i].offset = scan_offset;
+        frames[i].src = input.address + scan_offset;
+        if (tolerant_enable && setjmp(zdec_recover_env)) {
+            /* damaged tail: take the bytes that remain and reserve the
+               worst-case output for them */
+            frames[i].csize = input.size - scan_offset;
+            frames[i].dsize = MAX_COMPRESSION_RATIO * frames[i].csize;
+            sizes_known = 0;
+        } else {
+            zdec_recover_armed = tolerant_enable;
+            frames[i].csize = ZSTD_get_frame_compressed_size(frames[i].src,
+                                                             input.size - scan_offset);
+            if ((*(unsigned int*)frames[i].src & 0xFFFFFFF0U) == 0x184D2A50U) {
+                /* skippable frame: no content to decompress */
+                frames[i].dsize = 0;
+            } else {
+                frames[i].dsize = ZSTD_get_decompressed_size(frames[i].src,
+                                                             input.size - scan_offset);
+                if (frames[i].dsize == (size_t)-1) {
+                    frames[i].dsize = MAX_COMPRESSION_RATIO * frames[i].csize;
+                    sizes_known = 0;
+                    fprintf(stderr, "WARNING: Compressed data does not contain "
+                                    "decompressed size, going to assume the compression "
+                                    "ratio is at most %d (decompressed size of at most "
+                                    "%u) \n",
+                            MAX_COMPRESSION_RATIO, (unsigned)frames[i].dsize);
+                }
+            }
+            if (tolerant_enable && frames[i].csize > input.size - scan_offset)
+                frames[i].csize = input.size - scan_offset;
+        }
+        zdec_recover_armed = 0;
+        out_capacity += frames[i].dsize;
+        scan_offset += frames[i].csize;
     }
     if (out_capacity > MAX_OUTPUT_SIZE)
         ERR_OUT("Required output size too large for this implementation \n");
 
+    /* --incr: if the previous run's verified prefix still matches, decode
+       only the frames appended since then by reusing the range gate */
+    if (incremental && !range_enable) {
+        size_t prefix_len = load_incr_state(incr_state_file_name, input.address,
+                                            input.size);
+        int at_boundary = prefix_len == input.size;
+        for (i = 0; i < num_frames && prefix_len; i++)
+            if (frames[i].offset == prefix_len)
+                at_boundary = 1;
+        if (prefix_len && at_boundary) {
+            range_enable = 1;
+            range_offset = prefix_len;
+            range_len = input.size - prefix_len;
+            incr_ranged = 1;
+            fprintf(stderr, "incremental: skipping verified prefix of %lu bytes\n",
+                    (unsigned long)prefix_len);
+        } else if (prefix_len) {
+            fprintf(stderr, "incremental state does not end on a frame boundary, doing a full dump\n");
+        } else {
+            fprintf(stderr, "no usable incremental state, doing a full dump\n");
+        }
+    }
+
     u8* const output = malloc(out_capacity);
     if (!output) ERR_OUT("failed to allocate memory \n");
 
-    dictionary_t* const parsed_dict = create_dictionary();
-    if (dict.size) {
-        parse_dictionary(parsed_dict, dict.address, dict.size);
+    /* single-frame inputs keep the original JSON layout, multi-frame inputs
+       get one entry per frame under ZSTD_FRAMES, in file order */
+    cJSON* frames_json = NULL;
+    if (num_frames > 1)
+        frames_json = cJSON_AddArrayToObject(compressed_data_json, "ZSTD_FRAMES");
+    for (i = 0; i < num_frames; i++) {
+        frames[i].dict = parsed_dict;
+        frames[i].decompressed = 0;
+        frames[i].ret = 0;
+        frames[i].in_range = !range_enable ||
+            (frames[i].offset < range_offset + range_len &&
+             frames[i].offset + frames[i].csize > range_offset);
+        if (num_frames > 1) {
+            if (frames[i].in_range) {
+                frames[i].json = cJSON_CreateObject();
+                cJSON_AddItemToArray(frames_json, frames[i].json);
+            } else {
+                frames[i].json = NULL;
+            }
+        } else {
+            frames[i].json = compressed_data_json;
+        }
     }
 
-    ret = zstd_dump(output, out_capacity, input.address, input.size, parsed_dict, compressed_data_json);
+#ifdef HAVE_FRAME_WORKERS
+    if (num_threads > 1 && num_frames > 1 && sizes_known && !json_stream_enable &&
+        !stats_enable && !binary_sidecar_enable && !block_index_enable &&
+        !range_enable && !tolerant_enable) {
+        /* every frame knows its output slice in advance, so they can be
+           decoded concurrently; the stream writer, the binary sidecar and
+           the block index array are not thread safe, and unknown frame
+           sizes need the previous frame's actual output size, and the
+           --stats counters are unsynchronized, so those cases fall through
+           to the sequential loop below */
+        size_t dst_offset = 0;
+        for (i = 0; i < num_frames; i++) {
+            frames[i].dst = output + dst_offset;
+            frames[i].dst_len = frames[i].dsize;
+            dst_offset += frames[i].dsize;
+        }
 
-    char* jsonString = cJSON_Print(compressed_data_json);
-    if (compressed_data_log_file) {
-        fprintf(compressed_data_log_file, "%s", jsonString);
+        frame_pool_s pool = { .jobs = frames, .num_jobs = num_frames,
+                              .next_job = 0 };
+        pthread_mutex_init(&pool.lock, NULL);
+        if (num_threads > num_frames)
+            num_threads = num_frames;
+        pthread_t* const workers = malloc(num_threads * sizeof(pthread_t));
+        if (!workers) ERR_OUT("failed to allocate memory \n");
+        for (i = 0; i < num_threads; i++)
+            pthread_create(&workers[i], NULL, frame_worker, &pool);
+        for (i = 0; i < num_threads; i++)
+            pthread_join(workers[i], NULL);
+        free(workers);
+        pthread_mutex_destroy(&pool.lock);
+
+        for (i = 0; i < num_frames; i++) {
+            total_written += frames[i].decompressed;
+            if (frames[i].ret)
+                ret = frames[i].ret;
+        }
+    } else
+#endif
+    for (i = 0; i < num_frames; i++) {
+        if (!frames[i].in_range) {
+            if (range_enable && frames[i].offset >= range_offset + range_len)
+                break;          /* frames are in file order */
+            continue;
+        }
+        frames[i].dst = output + total_written;
+        frames[i].dst_len = out_capacity - total_written;
+        if (tolerant_enable && setjmp(zdec_recover_env)) {
+            /* the frame died mid-decode; keep the partial JSON built so
+               far, note what happened and move on to the next frame */
+            cJSON* error_json = cJSON_AddObjectToObject(frames[i].json, "DECODE_ERROR");
+            cJSON_AddNumberToObject(error_json, "frame", i);
+            cJSON_AddNumberToObject(error_json, "byte_offset", frames[i].offset);
+            cJSON_AddStringToObject(error_json, "description", zdec_error_msg);
+            /* the damage was recovered and recorded in the JSON, so the run
+               still exits 0, matching the deflate-family --tolerant paths */
+            frames[i].ret = 0;
+            continue;
+        }
+        zdec_recover_armed = tolerant_enable;
+        frames[i].ret = zstd_dump(frames[i].dst, frames[i].dst_len,
+                                  frames[i].src, frames[i].csize,
+                                  parsed_dict, frames[i].json,
+                                  &frames[i].decompressed);
+        zdec_recover_armed = 0;
+        total_written += frames[i].decompressed;
+        if (frames[i].ret)
+            ret = frames[i].ret;
+    }
+    zdec_recover_armed = 0;
+
+    stats_out_bytes = total_written;
+
+    double stats_t0 = stats_enable ? stats_now() : 0;
+    write_json_to_file(compressed_data_json, compressed_data_log_file);
+    if (stats_enable)
+        stats_json_write_time += stats_now() - stats_t0;
+    /* the index entries live with the rest of the tree, so the compact
+       sidecar has to go out before the tree is torn down below */
+    if (index_root_json != NULL) {
+        FILE *index_file = fopen(block_index_file_name, "w");
+        write_json_to_file_compact(index_root_json, index_file);
+        fclose(index_file);
+        block_index_json = NULL;
+        if (num_threads > 1)
+            cJSON_Delete(index_root_json);
+        index_root_json = NULL;
     }
-    cJSON_free(jsonString);
-    cJSON_Delete(compressed_data_json);
+
+    if (num_threads <= 1)
+        json_arena_release();
+    else
+        cJSON_Delete(compressed_data_json);
     fclose(compressed_data_log_file);
     compressed_data_log_file = NULL;
     compressed_data_json = NULL;
 
-    free_dictionary(parsed_dict);
-
     /* if requested, inflate again and write decompressed data to stdout */
     if (put) {
 
         if (wr_file) {
             decompressed_data_file = fopen(decompressed_file_name, "wb");
-            fwrite(output, 1, out_capacity, decompressed_data_file);
+            fwrite(output, 1, total_written, decompressed_data_file);
             fclose(decompressed_data_file);
+            decompressed_data_file = NULL;
         }
     }
 
+    if (stream_file) {
+        jw_end_document();
+        fclose(stream_file);
+    }
+
+    if (binary_sidecar_file) {
+        fclose(binary_sidecar_file);
+        binary_sidecar_file = NULL;
+    }
+
+    if (stats_enable)
+        stats_dump(stats_log_file_name);
+
     /* clean up */
+    /* record where this run ended so the next --incr run can resume */
+    if (incremental && ret == 0)
+        save_incr_state(incr_state_file_name, input.address, input.size,
+                        num_frames);
+    if (incr_ranged)
+        range_enable = 0;
+
+    free(frames);
     freeBuffer(input);
-    freeBuffer(dict);
     free(output);
 
     return ret;
 }
+
+/* Read the next file name from a batch list.  Names are separated by
+   newlines or NULs so both plain lists and find -print0 output work. */
+local int next_list_name(FILE *list, char *name, size_t size)
+{
+    int c;
+    size_t n = 0;
+
+    while ((c = getc(list)) != EOF) {
+        if (c == '\n' || c == '\r' || c == '\0') {
+            if (n)
+                break;
+            continue;
+        }
+        if (n + 1 < size)
+            name[n++] = c;
+    }
+    name[n] = 0;
+    return n > 0;
+}
+
+int main(int argc, char **argv)
+{
+    int ret = 0, put = 0, wr_file = 0, batch = 0;
+    int num_threads = 1, incremental = 0;
+    char *arg, *name = NULL, *dic_name = NULL;
+
+    /* process arguments */
+    while (arg = *++argv, --argc)
+        if (arg[0] == '-') {
+            if (arg[1] == 'w' && arg[2] == 0)
+                put = 1, wr_file = 1;
+            else if (arg[1] == 'v' && arg[2] == 0)
+                put = 1, print_data_verbose = 1;
+            else if (arg[1] == 'd' && arg[2] >= '0' && arg[2] <= '3'
+                     && arg[3] == 0)
+                put = 1, print_data_verbose = 1,
+                    print_detail_level = arg[2] - '0';
+            else if (arg[1] == 's' && arg[2] == 0)
+                json_stream_enable = 1;
+            else if (strcmp(arg, "--scan") == 0)
+                scan_only = 1;
+            else if (strcmp(arg, "--stats") == 0)
+                stats_enable = 1;
+            else if (strcmp(arg, "--index") == 0)
+                block_index_enable = 1;
+            else if (strcmp(arg, "--range") == 0 && argc > 1) {
+                char *colon;
+                arg = *++argv, --argc;
+                range_offset = strtoul(arg, &colon, 0);
+                if (*colon != ':') {
+                    fprintf(stderr, "invalid --range, expected OFFSET:LEN\n");
+                    return 3;
+                }
+                range_len = strtoul(colon + 1, NULL, 0);
+                range_enable = 1;
+            }
+            else if (strcmp(arg, "--tolerant") == 0)
+                tolerant_enable = 1;
+            else if (strcmp(arg, "--format=binary") == 0)
+                binary_format_enable = 1;
+            else if (strcmp(arg, "--incr") == 0)
+                incremental = 1;
+            else if (arg[1] == 'b' && arg[2] == 0)
+                binary_sidecar_enable = 1;
+            else if (arg[1] == 'B' && arg[2] == 0)
+                batch = 1;
+            else if (arg[1] == 'j' && arg[2] >= '1' && arg[2] <= '9')
+                num_threads = atoi(arg + 2);
+            else {
+                fprintf(stderr, "invalid option %s\n", arg);
+                return 3;
+            }
+        }
+        else if (name != NULL) {
+            if (dic_name != NULL) {
+                fprintf(stderr, "only one or two files name allowed\n");
+                return 3;
+            }
+            else {
+                dic_name = arg;
+            }
+        }
+        else
+            name = arg;
+
+    /* the dictionary is parsed once and reused across every input; the
+       digested tables are also cached next to the dictionary so repeated
+       invocations skip the HUF/FSE derivation entirely */
+    dictionary_t* const parsed_dict = create_dictionary();
+    if (dic_name) {
+        char digest_name[250] = {0};
+        buffer_s const dict = read_file(dic_name);
+        if (strlen(dic_name) < 200) {
+            strcpy(digest_name, dic_name);
+            strcat(digest_name, "_digest.bin");
+        }
+        if (digest_name[0] == 0 ||
+            !load_dictionary_digest(parsed_dict, dict.address, dict.size,
+                                    digest_name)) {
+            parse_dictionary(parsed_dict, dict.address, dict.size);
+            if (digest_name[0])
+                save_dictionary_digest(parsed_dict, dict.address, dict.size,
+                                       digest_name);
+        }
+        freeBuffer(dict);
+    }
+
+    /* batch mode: the name is a list of inputs (or the list comes from
+       stdin) and each entry gets its own dump in this one process */
+    if (batch) {
+        char list_name[250];
+        FILE *list = name == NULL ? stdin : fopen(name, "r");
+
+        if (list == NULL) {
+            fprintf(stderr, "could not open file list %s\n", name);
+            return 3;
+        }
+        while (next_list_name(list, list_name, sizeof(list_name)))
+            if (dump_file(list_name, parsed_dict, incremental, put, wr_file,
+                          num_threads))
+                ret = 1;
+        if (list != stdin)
+            fclose(list);
+    }
+    else {
+        ret = dump_file(name, parsed_dict, incremental, put, wr_file,
+                        num_threads);
+    }
+
+    free_dictionary(parsed_dict);
+    return ret;
+}